@@ -0,0 +1,439 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "breezedecorationharness.h"
+#include "breezedecorationstress.h"
+
+#include <KDecoration2/DecorationSettings>
+
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QGuiApplication>
+#include <QHoverEvent>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPainter>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QTimer>
+
+#include <algorithm>
+
+namespace Breeze
+{
+
+    //__________________________________________________________________
+    DecorationHarness::DecorationHarness()
+    {
+
+        m_settings = QSharedPointer<KDecoration2::DecorationSettings>::create( &m_bridge );
+        m_decoration = m_bridge.createDecoration( m_settings );
+
+        // settle initial layout and animations
+        wait( 500 );
+        m_bridge.takeDirtyRect();
+
+    }
+
+    //__________________________________________________________________
+    DecorationHarness::~DecorationHarness()
+    { delete m_decoration; }
+
+    //__________________________________________________________________
+    void DecorationHarness::wait( int duration )
+    {
+        QEventLoop loop;
+        QTimer::singleShot( duration, &loop, &QEventLoop::quit );
+        loop.exec();
+    }
+
+    //__________________________________________________________________
+    qint64 DecorationHarness::paintFrame()
+    {
+
+        QRect dirtyRect( m_bridge.takeDirtyRect() & m_decoration->rect() );
+
+        // the frame buffer is reallocated and fully repainted on resize, as the compositor does
+        if( m_frame.size() != m_decoration->size() )
+        {
+            m_frame = QImage( m_decoration->size(), QImage::Format_ARGB32_Premultiplied );
+            dirtyRect = m_decoration->rect();
+        }
+
+        if( dirtyRect.isEmpty() ) return -1;
+
+        QElapsedTimer timer;
+        timer.start();
+
+        QPainter painter( &m_frame );
+        painter.setCompositionMode( QPainter::CompositionMode_Source );
+        painter.fillRect( dirtyRect, Qt::transparent );
+        painter.setCompositionMode( QPainter::CompositionMode_SourceOver );
+        painter.setClipRect( dirtyRect );
+        m_decoration->paint( &painter, dirtyRect );
+        painter.end();
+
+        return timer.nsecsElapsed();
+
+    }
+
+    //__________________________________________________________________
+    void DecorationHarness::runFrames( int duration, Result &result )
+    {
+        QElapsedTimer timer;
+        timer.start();
+        while( timer.elapsed() < duration )
+        {
+            // one frame per vertical blank, at 60Hz
+            wait( 16 );
+            const qint64 time( paintFrame() );
+            if( time >= 0 ) result.frameTimes.append( time );
+        }
+    }
+
+    //__________________________________________________________________
+    QImage DecorationHarness::render() const
+    {
+        QImage image( m_decoration->size(), QImage::Format_ARGB32_Premultiplied );
+        image.fill( Qt::transparent );
+
+        QPainter painter( &image );
+        m_decoration->paint( &painter, m_decoration->rect() );
+        painter.end();
+
+        return image;
+    }
+
+    //__________________________________________________________________
+    void DecorationHarness::sendHoverEvent( QEvent::Type type, const QPoint &position )
+    {
+        QHoverEvent event( type, position, type == QEvent::HoverEnter ? QPoint( -1, -1 ) : position );
+        QCoreApplication::sendEvent( m_decoration, &event );
+    }
+
+    //__________________________________________________________________
+    QVector<DecorationHarness::Result> DecorationHarness::run()
+    {
+
+        QVector<Result> results;
+        const int animationDuration = m_decoration->internalSettings()->animationsDuration() + 100;
+
+        // active state change animation
+        {
+            Result result( QStringLiteral( "activation" ) );
+            m_bridge.client()->setActive( true );
+            runFrames( animationDuration, result );
+            result.image = render();
+            results.append( result );
+        }
+
+        // button hover animation, over the rightmost button
+        {
+            Result result( QStringLiteral( "hover" ) );
+            const QRect titleBar( m_decoration->titleBar() );
+            const QPoint position( titleBar.right() - m_decoration->buttonHeight()/2, titleBar.center().y() );
+            sendHoverEvent( QEvent::HoverEnter, position );
+            sendHoverEvent( QEvent::HoverMove, position );
+            runFrames( animationDuration, result );
+            result.image = render();
+
+            sendHoverEvent( QEvent::HoverLeave, QPoint( -1, -1 ) );
+            runFrames( animationDuration, result );
+            results.append( result );
+        }
+
+        // caption changes, one per frame
+        {
+            Result result( QStringLiteral( "caption" ) );
+            for( int i = 0; i < 240; ++i )
+            {
+                m_bridge.client()->setCaption( QStringLiteral( "Document %1 - %2" ).arg( i ).arg( QString( i%40, QLatin1Char( 'x' ) ) ) );
+                QCoreApplication::processEvents();
+                const qint64 time( paintFrame() );
+                if( time >= 0 ) result.frameTimes.append( time );
+            }
+
+            result.image = render();
+            results.append( result );
+        }
+
+        // interactive resize, one width change per frame, then wait for the resize to settle
+        {
+            Result result( QStringLiteral( "resize" ) );
+            const int height = m_bridge.client()->height();
+            for( int width = 800; width >= 400; width -= 8 )
+            {
+                m_bridge.client()->setSize( QSize( width, height ) );
+                runFrames( 16, result );
+            }
+
+            for( int width = 400; width <= 1200; width += 8 )
+            {
+                m_bridge.client()->setSize( QSize( width, height ) );
+                runFrames( 16, result );
+            }
+
+            runFrames( 300, result );
+            result.image = render();
+            results.append( result );
+        }
+
+        // maximization
+        {
+            Result result( QStringLiteral( "maximize" ) );
+            m_bridge.client()->setMaximized( true );
+            runFrames( 100, result );
+            result.image = render();
+
+            m_bridge.client()->setMaximized( false );
+            runFrames( 100, result );
+            results.append( result );
+        }
+
+        return results;
+
+    }
+
+}
+
+namespace
+{
+
+    //* nanoseconds at given quantile of the frame times
+    qint64 quantile( QVector<qint64> times, qreal value )
+    {
+        if( times.isEmpty() ) return 0;
+        std::sort( times.begin(), times.end() );
+        return times.at( qMin( times.size() - 1, int( value*times.size() ) ) );
+    }
+
+    //* number of pixels that differ between given images, or -1 if their sizes differ
+    int compareImages( const QImage &first, const QImage &second )
+    {
+        if( first.size() != second.size() ) return -1;
+
+        const QImage a( first.convertToFormat( QImage::Format_ARGB32_Premultiplied ) );
+        const QImage b( second.convertToFormat( QImage::Format_ARGB32_Premultiplied ) );
+
+        int count = 0;
+        for( int y = 0; y < a.height(); ++y )
+        {
+            auto lineA = reinterpret_cast<const QRgb*>( a.constScanLine( y ) );
+            auto lineB = reinterpret_cast<const QRgb*>( b.constScanLine( y ) );
+            for( int x = 0; x < a.width(); ++x )
+            { if( lineA[x] != lineB[x] ) ++count; }
+        }
+
+        return count;
+    }
+
+    //* write results as JSON
+    bool writeResults( const QString &fileName, const QJsonArray &results, QTextStream &err )
+    {
+        QFile file( fileName );
+        if( !file.open( QIODevice::WriteOnly|QIODevice::Truncate ) )
+        {
+            err << "cannot write " << file.fileName() << ": " << file.errorString() << Qt::endl;
+            return false;
+        }
+
+        QJsonObject root;
+        root.insert( QStringLiteral( "results" ), results );
+        file.write( QJsonDocument( root ).toJson() );
+        return true;
+    }
+
+    //* run the stress scenario, and print its results
+    int runStress( int windowCount, int cycles, const QString &outputFileName )
+    {
+        QTextStream out( stdout );
+        QTextStream err( stderr );
+
+        QVector<Breeze::DecorationStress::Result> results;
+        {
+            Breeze::DecorationStress stress( windowCount );
+            results = stress.run( cycles );
+        }
+
+        QJsonArray array;
+        for( const auto &result : qAsConst( results ) )
+        {
+            out << qSetFieldWidth( 20 ) << Qt::left << result.name << qSetFieldWidth( 0 )
+                << result.nsPerOperation/1000 << " us/window, event loop " << result.eventLoopCpuMs << " ms cpu, "
+                << result.allocationsPerWindow << " allocations/window, heap " << result.heapBytesPerWindow << " B/window, "
+                << result.objectsPerWindow << " objects/window, rss " << result.rssKiB << " KiB" << Qt::endl;
+            array.append( result.toJson() );
+        }
+
+        if( !outputFileName.isEmpty() && !writeResults( outputFileName, array, err ) ) return 2;
+        return 0;
+    }
+
+    //* check that a window without borders keeps them when it gets a size grip
+    /**
+    with the shipped breezerc, which draws the size grip, and no borders set in the window manager,
+    a resizeable window shows the grip. It must not change the window geometry: the borders are the
+    title bar only, as they were when the grip was a separate window
+    */
+    int runBorderCheck( const QString &configFileName )
+    {
+        QTextStream out( stdout );
+        QTextStream err( stderr );
+
+        // the harness runs in test mode, so the file is installed as the user configuration
+        const QDir configDir( QStandardPaths::writableLocation( QStandardPaths::GenericConfigLocation ) );
+        const QString target( configDir.filePath( QStringLiteral( "breezerc" ) ) );
+        QFile::remove( target );
+        if( !configDir.mkpath( QStringLiteral( "." ) ) || !QFile::copy( configFileName, target ) )
+        {
+            err << "cannot install " << configFileName << " as " << target << Qt::endl;
+            return 2;
+        }
+
+        Breeze::MockBridge bridge;
+        bridge.setBorderSize( KDecoration2::BorderSize::None );
+        const auto settings = QSharedPointer<KDecoration2::DecorationSettings>::create( &bridge );
+        Breeze::Decoration *decoration = bridge.createDecoration( settings );
+        Breeze::DecorationHarness::wait( 100 );
+
+        const QMargins expected( 0, int( 22*decoration->scaleFactor() ), 0, 0 );
+        const QMargins borders( decoration->borders() );
+        delete decoration;
+        QFile::remove( target );
+
+        out << "borders " << borders.left() << " " << borders.top() << " " << borders.right() << " " << borders.bottom()
+            << ", expected " << expected.left() << " " << expected.top() << " " << expected.right() << " " << expected.bottom() << Qt::endl;
+        return borders == expected ? 0:1;
+    }
+
+}
+
+int main( int argc, char **argv )
+{
+
+    // rendering must not depend on the display, nor on user settings
+    if( qEnvironmentVariableIsEmpty( "QT_QPA_PLATFORM" ) ) qputenv( "QT_QPA_PLATFORM", "offscreen" );
+    QStandardPaths::setTestModeEnabled( true );
+
+    QGuiApplication app( argc, argv );
+    QCoreApplication::setApplicationName( QStringLiteral( "breezeenhanced_harness" ) );
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription( QStringLiteral( "Render the decoration headlessly, measure paint cost and compare against golden images." ) );
+    parser.addHelpOption();
+
+    const QCommandLineOption goldenOption( QStringLiteral( "golden" ),
+        QStringLiteral( "Directory holding the golden images." ), QStringLiteral( "directory" ) );
+    const QCommandLineOption updateOption( QStringLiteral( "update-golden" ),
+        QStringLiteral( "Write the rendered images as the new golden images." ) );
+    const QCommandLineOption outputOption( QStringLiteral( "output" ),
+        QStringLiteral( "Write the results as JSON to <file>." ), QStringLiteral( "file" ) );
+    const QCommandLineOption stressOption( QStringLiteral( "stress" ),
+        QStringLiteral( "Instead of the rendering scenarios, create <count> decorations and exercise them together." ), QStringLiteral( "count" ) );
+    const QCommandLineOption cyclesOption( QStringLiteral( "cycles" ),
+        QStringLiteral( "Number of create and destroy cycles of the stress scenario. Defaults to 3." ), QStringLiteral( "cycles" ), QStringLiteral( "3" ) );
+    const QCommandLineOption bordersOption( QStringLiteral( "check-borders" ),
+        QStringLiteral( "Instead of the rendering scenarios, check that with <breezerc> and no borders, the size grip leaves the window borders unchanged." ), QStringLiteral( "breezerc" ) );
+    parser.addOptions( { goldenOption, updateOption, outputOption, stressOption, cyclesOption, bordersOption } );
+    parser.process( app );
+
+    if( parser.isSet( bordersOption ) )
+    { return runBorderCheck( parser.value( bordersOption ) ); }
+
+    if( parser.isSet( stressOption ) )
+    { return runStress( parser.value( stressOption ).toInt(), parser.value( cyclesOption ).toInt(), parser.value( outputOption ) ); }
+
+    QTextStream out( stdout );
+    QTextStream err( stderr );
+
+    QVector<Breeze::DecorationHarness::Result> results;
+    {
+        Breeze::DecorationHarness harness;
+        results = harness.run();
+    }
+
+    const QDir goldenDir( parser.value( goldenOption ) );
+    if( parser.isSet( updateOption ) && !goldenDir.mkpath( QStringLiteral( "." ) ) )
+    {
+        err << "cannot create " << goldenDir.path() << Qt::endl;
+        return 2;
+    }
+
+    int mismatches = 0;
+    QJsonArray array;
+    for( const auto &result : qAsConst( results ) )
+    {
+
+        const qint64 median( quantile( result.frameTimes, 0.5 ) );
+        const qint64 p95( quantile( result.frameTimes, 0.95 ) );
+        const qint64 max( quantile( result.frameTimes, 1 ) );
+
+        out << qSetFieldWidth( 12 ) << Qt::left << result.name << qSetFieldWidth( 0 )
+            << result.frameTimes.size() << " frames, median " << median/1000 << " us, p95 "
+            << p95/1000 << " us, max " << max/1000 << " us";
+
+        if( parser.isSet( goldenOption ) )
+        {
+            const QString fileName( goldenDir.filePath( result.name + QStringLiteral( ".png" ) ) );
+            if( parser.isSet( updateOption ) )
+            {
+
+                if( result.image.save( fileName ) ) out << ", golden image written";
+                else {
+                    err << "cannot write " << fileName << Qt::endl;
+                    return 2;
+                }
+
+            } else {
+
+                const QImage golden( fileName );
+                if( golden.isNull() ) out << ", no golden image";
+                else {
+                    const int count( compareImages( result.image, golden ) );
+                    if( count == 0 ) out << ", matches golden image";
+                    else {
+                        ++mismatches;
+                        if( count < 0 ) out << ", MISMATCH: size differs from golden image";
+                        else out << ", MISMATCH: " << count << " pixels differ from golden image";
+                    }
+                }
+
+            }
+        }
+
+        out << Qt::endl;
+
+        QJsonObject object;
+        object.insert( QStringLiteral( "name" ), result.name );
+        object.insert( QStringLiteral( "frames" ), result.frameTimes.size() );
+        object.insert( QStringLiteral( "medianNs" ), median );
+        object.insert( QStringLiteral( "p95Ns" ), p95 );
+        object.insert( QStringLiteral( "maxNs" ), max );
+        array.append( object );
+
+    }
+
+    if( parser.isSet( outputOption ) && !writeResults( parser.value( outputOption ), array, err ) ) return 2;
+
+    return mismatches > 0 ? 1:0;
+
+}
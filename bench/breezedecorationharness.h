@@ -0,0 +1,105 @@
+#ifndef breezedecorationharness_h
+#define breezedecorationharness_h
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "breezedecoration.h"
+#include "breezemockbridge.h"
+
+#include <QEvent>
+#include <QImage>
+#include <QVector>
+
+namespace Breeze
+{
+
+    //* runs a decoration outside of the window manager, and paints it into images
+    class DecorationHarness
+    {
+
+        public:
+
+        //* scenario result
+        struct Result
+        {
+            explicit Result( const QString &name = QString() ):
+                name( name )
+            {}
+
+            QString name;
+
+            //* paint duration of each frame that had something to repaint, in nanoseconds
+            QVector<qint64> frameTimes;
+
+            //* full rendering at the end of the scenario, compared to the golden image
+            QImage image;
+        };
+
+        //* constructor
+        DecorationHarness();
+
+        //* destructor
+        ~DecorationHarness();
+
+        //* run all scenarios
+        QVector<Result> run();
+
+        //* mock bridge
+        MockBridge &bridge()
+        { return m_bridge; }
+
+        //* decoration
+        Decoration *decoration() const
+        { return m_decoration; }
+
+        //* paint the area the decoration asked to repaint into the frame buffer
+        /** returns the paint duration in nanoseconds, or -1 if there was nothing to repaint */
+        qint64 paintFrame();
+
+        //* process events and paint frames at display rate, for given duration in milliseconds
+        void runFrames( int duration, Result& );
+
+        //* paint the whole decoration into a new image
+        QImage render() const;
+
+        //* send a hover event to the decoration
+        void sendHoverEvent( QEvent::Type, const QPoint& );
+
+        //* process events for given duration, in milliseconds
+        static void wait( int duration );
+
+        private:
+
+        //* bridge, must outlive the decoration
+        MockBridge m_bridge;
+
+        //* settings
+        QSharedPointer<KDecoration2::DecorationSettings> m_settings;
+
+        //* decoration
+        Decoration *m_decoration = nullptr;
+
+        //* frame buffer, only repainted where the decoration asked for
+        QImage m_frame;
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,249 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "breezedecorationstress.h"
+#include "breezedecorationharness.h"
+
+#include <KDecoration2/DecorationSettings>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHoverEvent>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace
+{
+
+    //* number of operator new calls, in the whole process
+    std::atomic<quint64> s_allocationCount( 0 );
+
+    //* bytes in use on the heap
+    qint64 heapBytes()
+    {
+        #if defined(__GLIBC__) && ( __GLIBC__ > 2 || ( __GLIBC__ == 2 && __GLIBC_MINOR__ >= 33 ) )
+        return mallinfo2().uordblks;
+        #elif defined(__GLIBC__)
+        return quint32( mallinfo().uordblks );
+        #else
+        return 0;
+        #endif
+    }
+
+    //* current resident set size, in KiB
+    /** falls back to the peak resident set size where /proc/self/statm is not available, FreeBSD for instance */
+    qint64 residentSetSize()
+    {
+        QFile file( QStringLiteral( "/proc/self/statm" ) );
+        if( file.open( QIODevice::ReadOnly ) )
+        {
+            const QList<QByteArray> fields( file.readAll().split( ' ' ) );
+            if( fields.size() >= 2 ) return fields.at( 1 ).toLongLong()*sysconf( _SC_PAGESIZE )/1024;
+        }
+
+        // ru_maxrss is in KiB on Linux and the BSDs
+        struct rusage usage;
+        if( getrusage( RUSAGE_SELF, &usage ) != 0 ) return 0;
+        return usage.ru_maxrss;
+    }
+
+    //* processor time used by the process, in milliseconds
+    qreal cpuTime()
+    {
+        struct rusage usage;
+        if( getrusage( RUSAGE_SELF, &usage ) != 0 ) return 0;
+        return ( usage.ru_utime.tv_sec + usage.ru_stime.tv_sec )*1000.0
+            + ( usage.ru_utime.tv_usec + usage.ru_stime.tv_usec )/1000.0;
+    }
+
+}
+
+//* count allocations. Replacing the global operator also counts allocations made from Qt and KDecoration2
+void *operator new( std::size_t size )
+{
+    s_allocationCount.fetch_add( 1, std::memory_order_relaxed );
+    if( void *pointer = std::malloc( size ? size:1 ) ) return pointer;
+    throw std::bad_alloc();
+}
+
+void operator delete( void *pointer ) noexcept
+{ std::free( pointer ); }
+
+namespace Breeze
+{
+
+    //__________________________________________________________________
+    QJsonObject DecorationStress::Result::toJson() const
+    {
+        QJsonObject object;
+        object.insert( QStringLiteral( "name" ), name );
+        object.insert( QStringLiteral( "count" ), count );
+        object.insert( QStringLiteral( "nsPerOperation" ), nsPerOperation );
+        object.insert( QStringLiteral( "eventLoopCpuMs" ), eventLoopCpuMs );
+        object.insert( QStringLiteral( "heapBytesPerWindow" ), heapBytesPerWindow );
+        object.insert( QStringLiteral( "allocationsPerWindow" ), allocationsPerWindow );
+        object.insert( QStringLiteral( "rssKiB" ), rssKiB );
+        object.insert( QStringLiteral( "objectsPerWindow" ), objectsPerWindow );
+        return object;
+    }
+
+    //__________________________________________________________________
+    DecorationStress::DecorationStress( int windowCount ):
+        m_windowCount( windowCount )
+    { m_settings = QSharedPointer<KDecoration2::DecorationSettings>::create( &m_bridge ); }
+
+    //__________________________________________________________________
+    DecorationStress::~DecorationStress()
+    { destroyWindows(); }
+
+    //__________________________________________________________________
+    void DecorationStress::createWindows()
+    {
+        m_windows.resize( m_windowCount );
+        for( DecoratedWindow &window : m_windows )
+        {
+            window.decoration = m_bridge.createDecoration( m_settings );
+            window.client = m_bridge.client();
+        }
+    }
+
+    //__________________________________________________________________
+    void DecorationStress::destroyWindows()
+    {
+        for( DecoratedWindow &window : m_windows ) delete window.decoration;
+        m_windows.clear();
+    }
+
+    //__________________________________________________________________
+    qreal DecorationStress::objectsPerWindow() const
+    {
+        if( m_windows.isEmpty() ) return 0;
+
+        qint64 count = 0;
+        for( const DecoratedWindow &window : m_windows )
+        { count += 1 + window.decoration->findChildren<QObject*>().size(); }
+
+        return qreal( count )/m_windows.size();
+    }
+
+    //__________________________________________________________________
+    DecorationStress::Result DecorationStress::measure( const QString &name, const std::function<void()> &operation, int settleTime )
+    {
+
+        const qint64 heap( heapBytes() );
+        const quint64 allocations( s_allocationCount.load( std::memory_order_relaxed ) );
+
+        QElapsedTimer timer;
+        timer.start();
+        operation();
+        const qint64 elapsed( timer.nsecsElapsed() );
+
+        // deferred layouts, animations and deleteLater
+        const qreal cpu( cpuTime() );
+        DecorationHarness::wait( settleTime );
+        QCoreApplication::sendPostedEvents( nullptr, QEvent::DeferredDelete );
+
+        const int windowCount( qMax( 1, m_windowCount ) );
+
+        Result result;
+        result.name = name;
+        result.count = m_windowCount;
+        result.nsPerOperation = qreal( elapsed )/windowCount;
+        result.eventLoopCpuMs = cpuTime() - cpu;
+        result.heapBytesPerWindow = qreal( heapBytes() - heap )/windowCount;
+        result.allocationsPerWindow = qreal( s_allocationCount.load( std::memory_order_relaxed ) - allocations )/windowCount;
+        result.rssKiB = residentSetSize();
+        result.objectsPerWindow = objectsPerWindow();
+        return result;
+
+    }
+
+    //__________________________________________________________________
+    QVector<DecorationStress::Result> DecorationStress::run( int cycles )
+    {
+
+        QVector<Result> results;
+        for( int cycle = 0; cycle < cycles; ++cycle )
+        {
+
+            const QString prefix( QStringLiteral( "cycle%1/" ).arg( cycle ) );
+
+            results.append( measure( prefix + QStringLiteral( "create" ), [this]() { createWindows(); }, 100 ) );
+
+            const int animationDuration( m_windows.isEmpty() ? 0 : m_windows.first().decoration->internalSettings()->animationsDuration() + 100 );
+
+            // activation, all windows animating at once
+            results.append( measure( prefix + QStringLiteral( "activate" ), [this]()
+            { for( DecoratedWindow &window : m_windows ) window.client->setActive( true ); },
+            animationDuration ) );
+
+            results.append( measure( prefix + QStringLiteral( "deactivate" ), [this]()
+            { for( DecoratedWindow &window : m_windows ) window.client->setActive( false ); },
+            animationDuration ) );
+
+            // hover the rightmost button of every window, then leave
+            results.append( measure( prefix + QStringLiteral( "hover" ), [this]()
+            {
+                for( DecoratedWindow &window : m_windows )
+                {
+                    const QRect titleBar( window.decoration->titleBar() );
+                    const QPoint position( titleBar.right() - window.decoration->buttonHeight()/2, titleBar.center().y() );
+                    QHoverEvent enter( QEvent::HoverEnter, position, QPoint( -1, -1 ) );
+                    QCoreApplication::sendEvent( window.decoration, &enter );
+                    QHoverEvent move( QEvent::HoverMove, position, position );
+                    QCoreApplication::sendEvent( window.decoration, &move );
+                }
+            }, animationDuration ) );
+
+            results.append( measure( prefix + QStringLiteral( "leave" ), [this]()
+            {
+                for( DecoratedWindow &window : m_windows )
+                {
+                    QHoverEvent leave( QEvent::HoverLeave, QPoint( -1, -1 ), QPoint( -1, -1 ) );
+                    QCoreApplication::sendEvent( window.decoration, &leave );
+                }
+            }, animationDuration ) );
+
+            // caption changes
+            results.append( measure( prefix + QStringLiteral( "caption" ), [this]()
+            {
+                int index = 0;
+                for( DecoratedWindow &window : m_windows )
+                { window.client->setCaption( QStringLiteral( "Window %1 - changed caption" ).arg( index++ ) ); }
+            } ) );
+
+            // heap and resident size should come back to where they were before creation
+            results.append( measure( prefix + QStringLiteral( "destroy" ), [this]() { destroyWindows(); }, 100 ) );
+
+        }
+
+        return results;
+
+    }
+
+}
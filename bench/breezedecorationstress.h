@@ -0,0 +1,104 @@
+#ifndef breezedecorationstress_h
+#define breezedecorationstress_h
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "breezedecoration.h"
+#include "breezemockbridge.h"
+
+#include <QJsonObject>
+#include <QVector>
+
+#include <functional>
+
+namespace Breeze
+{
+
+    //* creates many decorations sharing one bridge, and measures per window costs
+    class DecorationStress
+    {
+
+        public:
+
+        //* operation result
+        struct Result
+        {
+            QString name;
+
+            //* number of operations
+            int count = 0;
+
+            //* wall time per operation, in nanoseconds
+            qreal nsPerOperation = 0;
+
+            //* processor time spent by the event loop afterwards, animations mostly, in milliseconds
+            qreal eventLoopCpuMs = 0;
+
+            //* heap growth and allocations per window, during the operation
+            qreal heapBytesPerWindow = 0;
+            qreal allocationsPerWindow = 0;
+
+            //* resident set size after the operation, in KiB. Peak resident set size where /proc is not available
+            qint64 rssKiB = 0;
+
+            //* QObjects per window after the operation
+            qreal objectsPerWindow = 0;
+
+            QJsonObject toJson() const;
+        };
+
+        //* constructor
+        explicit DecorationStress( int windowCount );
+
+        //* destructor
+        ~DecorationStress();
+
+        //* create and destroy all windows given number of times, exercising them in between
+        QVector<Result> run( int cycles );
+
+        private:
+
+        //* a decorated window
+        struct DecoratedWindow
+        {
+            Decoration *decoration = nullptr;
+            MockClient *client = nullptr;
+        };
+
+        //* run operation, then let the event loop run for given duration in milliseconds
+        Result measure( const QString &name, const std::function<void()>&, int settleTime = 0 );
+
+        void createWindows();
+        void destroyWindows();
+
+        //* QObjects per window, counting the decoration and its children
+        qreal objectsPerWindow() const;
+
+        //* shared bridge and settings, as in the window manager
+        MockBridge m_bridge;
+        QSharedPointer<KDecoration2::DecorationSettings> m_settings;
+
+        int m_windowCount = 0;
+        QVector<DecoratedWindow> m_windows;
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,155 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "breezemockbridge.h"
+#include "breezedecoration.h"
+
+#include <KDecoration2/DecoratedClient>
+#include <KDecoration2/DecorationSettings>
+
+namespace Breeze
+{
+
+    //__________________________________________________________________
+    MockClient::MockClient( KDecoration2::DecoratedClient *client, KDecoration2::Decoration *decoration ):
+        KDecoration2::DecoratedClientPrivate( client, decoration ),
+        m_caption( QStringLiteral( "Breeze decoration harness" ) ),
+        m_size( 800, 600 )
+    {}
+
+    //__________________________________________________________________
+    QColor MockClient::color( KDecoration2::ColorGroup group, KDecoration2::ColorRole role ) const
+    {
+        // fixed colors, so that rendering does not depend on the color scheme
+        const bool active = group == KDecoration2::ColorGroup::Active;
+        switch( role )
+        {
+            case KDecoration2::ColorRole::Frame:
+            case KDecoration2::ColorRole::TitleBar:
+            return active ? QColor( 71, 80, 87 ) : QColor( 239, 240, 241 );
+
+            case KDecoration2::ColorRole::Foreground:
+            return active ? QColor( 252, 252, 252 ) : QColor( 189, 195, 199 );
+
+            default: return QColor();
+        }
+    }
+
+    //__________________________________________________________________
+    void MockClient::setActive( bool value )
+    {
+        if( m_active == value ) return;
+        m_active = value;
+        emit client()->activeChanged( value );
+    }
+
+    //__________________________________________________________________
+    void MockClient::setCaption( const QString &value )
+    {
+        if( m_caption == value ) return;
+        m_caption = value;
+        emit client()->captionChanged( value );
+    }
+
+    //__________________________________________________________________
+    void MockClient::setMaximized( bool value )
+    {
+        if( m_maximized == value ) return;
+        m_maximized = value;
+        emit client()->maximizedHorizontallyChanged( value );
+        emit client()->maximizedVerticallyChanged( value );
+        emit client()->maximizedChanged( value );
+        emit client()->adjacentScreenEdgesChanged( adjacentScreenEdges() );
+    }
+
+    //__________________________________________________________________
+    void MockClient::setShaded( bool value )
+    {
+        if( m_shaded == value ) return;
+        m_shaded = value;
+        emit client()->shadedChanged( value );
+    }
+
+    //__________________________________________________________________
+    void MockClient::setSize( const QSize &size )
+    {
+        if( m_size == size ) return;
+        const QSize oldSize( m_size );
+        m_size = size;
+        if( size.width() != oldSize.width() ) emit client()->widthChanged( size.width() );
+        if( size.height() != oldSize.height() ) emit client()->heightChanged( size.height() );
+    }
+
+    //__________________________________________________________________
+    MockSettings::MockSettings( KDecoration2::DecorationSettings *parent, KDecoration2::BorderSize borderSize ):
+        KDecoration2::DecorationSettingsPrivate( parent ),
+        m_borderSize( borderSize )
+    {}
+
+    //__________________________________________________________________
+    QVector<KDecoration2::DecorationButtonType> MockSettings::decorationButtonsLeft() const
+    {
+        return {
+            KDecoration2::DecorationButtonType::Menu,
+            KDecoration2::DecorationButtonType::OnAllDesktops };
+    }
+
+    //__________________________________________________________________
+    QVector<KDecoration2::DecorationButtonType> MockSettings::decorationButtonsRight() const
+    {
+        return {
+            KDecoration2::DecorationButtonType::Minimize,
+            KDecoration2::DecorationButtonType::Maximize,
+            KDecoration2::DecorationButtonType::Close };
+    }
+
+    //__________________________________________________________________
+    std::unique_ptr<KDecoration2::DecoratedClientPrivate> MockBridge::createClient( KDecoration2::DecoratedClient *client, KDecoration2::Decoration *decoration )
+    {
+        auto mockClient = new MockClient( client, decoration );
+        m_client = mockClient;
+        return std::unique_ptr<KDecoration2::DecoratedClientPrivate>( mockClient );
+    }
+
+    //__________________________________________________________________
+    std::unique_ptr<KDecoration2::DecorationSettingsPrivate> MockBridge::settings( KDecoration2::DecorationSettings *parent )
+    { return std::unique_ptr<KDecoration2::DecorationSettingsPrivate>( new MockSettings( parent, m_borderSize ) ); }
+
+    //__________________________________________________________________
+    Decoration *MockBridge::createDecoration( const QSharedPointer<KDecoration2::DecorationSettings> &settings )
+    {
+        // the window manager passes its bridge to the plugin factory the same way
+        auto decoration = new Decoration( nullptr, QVariantList{ QVariantMap{ { QStringLiteral( "bridge" ), QVariant::fromValue( static_cast<KDecoration2::DecorationBridge*>( this ) ) } } } );
+        decoration->setSettings( settings );
+        decoration->init();
+        return decoration;
+    }
+
+    //__________________________________________________________________
+    void MockBridge::update( KDecoration2::Decoration*, const QRect &rect )
+    { m_dirtyRect |= rect; }
+
+    //__________________________________________________________________
+    QRect MockBridge::takeDirtyRect()
+    {
+        const QRect rect( m_dirtyRect );
+        m_dirtyRect = QRect();
+        return rect;
+    }
+
+}
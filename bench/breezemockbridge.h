@@ -0,0 +1,178 @@
+#ifndef breezemockbridge_h
+#define breezemockbridge_h
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <KDecoration2/Private/DecoratedClientPrivate>
+#include <KDecoration2/Private/DecorationBridge>
+#include <KDecoration2/Private/DecorationSettingsPrivate>
+
+#include <QPalette>
+#include <QSharedPointer>
+
+namespace KDecoration2
+{
+    class DecorationSettings;
+}
+
+namespace Breeze
+{
+
+    class Decoration;
+
+    //* stand-in for a window manager client, whose state is changed by the harness
+    class MockClient: public KDecoration2::DecoratedClientPrivate
+    {
+
+        public:
+
+        //* constructor
+        explicit MockClient( KDecoration2::DecoratedClient*, KDecoration2::Decoration* );
+
+        //*@name client state
+        //@{
+        bool isActive() const override { return m_active; }
+        QString caption() const override { return m_caption; }
+        int desktop() const override { return 1; }
+        bool isOnAllDesktops() const override { return false; }
+        bool isShaded() const override { return m_shaded; }
+        QIcon icon() const override { return QIcon(); }
+        bool isMaximized() const override { return m_maximized; }
+        bool isMaximizedHorizontally() const override { return m_maximized; }
+        bool isMaximizedVertically() const override { return m_maximized; }
+        bool isKeepAbove() const override { return false; }
+        bool isKeepBelow() const override { return false; }
+
+        bool isCloseable() const override { return true; }
+        bool isMaximizeable() const override { return true; }
+        bool isMinimizeable() const override { return true; }
+        bool providesContextHelp() const override { return false; }
+        bool isModal() const override { return false; }
+        bool isShadeable() const override { return true; }
+        bool isMoveable() const override { return true; }
+        bool isResizeable() const override { return true; }
+
+        WId windowId() const override { return 0; }
+        WId decorationId() const override { return 0; }
+
+        int width() const override { return m_size.width(); }
+        int height() const override { return m_size.height(); }
+        QSize size() const override { return m_size; }
+        QPalette palette() const override { return m_palette; }
+        QColor color( KDecoration2::ColorGroup, KDecoration2::ColorRole ) const override;
+        Qt::Edges adjacentScreenEdges() const override { return m_maximized ? Qt::TopEdge|Qt::LeftEdge|Qt::RightEdge|Qt::BottomEdge : Qt::Edges(); }
+        //@}
+
+        //*@name requests, ignored
+        //@{
+        void requestShowToolTip( const QString& ) override {}
+        void requestHideToolTip() override {}
+        void requestClose() override {}
+        void requestToggleMaximization( Qt::MouseButtons ) override {}
+        void requestMinimize() override {}
+        void requestContextHelp() override {}
+        void requestToggleOnAllDesktops() override {}
+        void requestToggleShade() override {}
+        void requestToggleKeepAbove() override {}
+        void requestToggleKeepBelow() override {}
+        void requestShowWindowMenu() override {}
+        //@}
+
+        //*@name state changes, emitting the client signals
+        //@{
+        void setActive( bool );
+        void setCaption( const QString& );
+        void setMaximized( bool );
+        void setShaded( bool );
+        void setSize( const QSize& );
+        //@}
+
+        private:
+
+        bool m_active = false;
+        bool m_maximized = false;
+        bool m_shaded = false;
+        QString m_caption;
+        QSize m_size;
+        QPalette m_palette;
+
+    };
+
+    //* stand-in for the window manager decoration settings
+    class MockSettings: public KDecoration2::DecorationSettingsPrivate
+    {
+
+        public:
+
+        //* constructor
+        explicit MockSettings( KDecoration2::DecorationSettings*, KDecoration2::BorderSize );
+
+        bool isAlphaChannelSupported() const override { return true; }
+        bool isOnAllDesktopsAvailable() const override { return true; }
+        bool isCloseOnDoubleClickOnMenu() const override { return false; }
+        QVector<KDecoration2::DecorationButtonType> decorationButtonsLeft() const override;
+        QVector<KDecoration2::DecorationButtonType> decorationButtonsRight() const override;
+        KDecoration2::BorderSize borderSize() const override { return m_borderSize; }
+
+        private:
+
+        KDecoration2::BorderSize m_borderSize;
+
+    };
+
+    //* decoration bridge, creating mock clients and settings instead of talking to the window manager
+    class MockBridge: public KDecoration2::DecorationBridge
+    {
+
+        Q_OBJECT
+
+        public:
+
+        std::unique_ptr<KDecoration2::DecoratedClientPrivate> createClient( KDecoration2::DecoratedClient*, KDecoration2::Decoration* ) override;
+        std::unique_ptr<KDecoration2::DecorationSettingsPrivate> settings( KDecoration2::DecorationSettings* ) override;
+
+        //* repaint requests are accumulated, until taken by the harness
+        void update( KDecoration2::Decoration*, const QRect& ) override;
+
+        //* create and initialize a decoration using this bridge and given settings
+        /** the client of the new decoration is client() until the next decoration is created */
+        Decoration *createDecoration( const QSharedPointer<KDecoration2::DecorationSettings>& );
+
+        //* last created client
+        MockClient *client() const
+        { return m_client; }
+
+        //* border size of the settings created afterwards, as set in the window manager
+        void setBorderSize( KDecoration2::BorderSize value )
+        { m_borderSize = value; }
+
+        //* area the decoration asked to be repainted since last call
+        QRect takeDirtyRect();
+
+        private:
+
+        MockClient *m_client = nullptr;
+        QRect m_dirtyRect;
+        KDecoration2::BorderSize m_borderSize = KDecoration2::BorderSize::Normal;
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,516 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// own
+#include "breeze.h"
+#include "breezeboxblur.h"
+#include "breezeboxshadowrenderer.h"
+#include "breezeshadowparams.h"
+
+// Qt
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <QVector>
+#include <QtMath>
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// POSIX
+#include <sys/resource.h>
+
+using namespace Breeze;
+
+namespace
+{
+
+struct Result
+{
+    QString name;
+    qint64 pixels = 0;
+    qreal nsPerRun = 0;
+    qreal nsPerPixel = 0;
+    qint64 allocationsPerRun = 0;
+    qint64 imageBytes = 0;
+};
+
+struct Comparison
+{
+    QString name;
+    int maxDifference = 0;
+    qreal rmsDifference = 0;
+};
+
+// number of operator new calls, in the whole process
+std::atomic<quint64> s_allocationCount(0);
+
+/**
+ * @returns The peak resident set size of the process, in KiB.
+ **/
+qint64 peakRssKiB()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1;
+    }
+
+    return usage.ru_maxrss;
+}
+
+/**
+ * Run the function repeatedly, for at least the given time.
+ *
+ * @returns The median duration of a run, in nanoseconds.
+ **/
+template <typename Function>
+qreal measure(Function function, int minTime)
+{
+    // the first run warms up caches and the allocator
+    function();
+
+    QVector<qint64> samples;
+    QElapsedTimer total;
+    total.start();
+    while (samples.size() < 5 || (total.elapsed() < minTime && samples.size() < 100000)) {
+        QElapsedTimer timer;
+        timer.start();
+        function();
+        samples.append(timer.nsecsElapsed());
+    }
+
+    auto median = samples.begin() + samples.size() / 2;
+    std::nth_element(samples.begin(), median, samples.end());
+    return *median;
+}
+
+/**
+ * @returns The number of operator new calls made by one run of the function.
+ **/
+template <typename Function>
+qint64 countAllocations(Function function)
+{
+    const quint64 count = s_allocationCount.load(std::memory_order_relaxed);
+    function();
+    return s_allocationCount.load(std::memory_order_relaxed) - count;
+}
+
+/**
+ * Setup the renderer the way the decoration does for the given preset.
+ **/
+void setupRenderer(BoxShadowRenderer &renderer, const CompositeShadowParams &params,
+                   qreal scale, qreal dpr, int boxMargin)
+{
+    const QSize boxSize = BoxShadowRenderer::calculateMinimumBoxSize(params.shadow1.radius * scale)
+        .expandedTo(BoxShadowRenderer::calculateMinimumBoxSize(params.shadow2.radius * scale))
+        + QSize(boxMargin, boxMargin);
+
+    renderer.setBorderRadius((Metrics::Frame_FrameRadius + 0.5) * scale);
+    renderer.setBoxSize(boxSize);
+    renderer.setDevicePixelRatio(dpr);
+
+    QColor color(Qt::black);
+    color.setAlphaF(params.shadow1.opacity);
+    renderer.addShadow(params.shadow1.offset, params.shadow1.radius * scale, color);
+
+    color.setAlphaF(params.shadow2.opacity);
+    renderer.addShadow(params.shadow2.offset, params.shadow2.radius * scale, color);
+}
+
+QVector<Result> runShadowBenchmarks(int minTime)
+{
+    const char *const presetNames[] = {"none", "small", "medium", "large", "verylarge"};
+    const qreal scales[] = {1.0, 1.5, 2.0};
+    const qreal dprs[] = {1.0, 1.5, 2.0, 3.0};
+    const int boxMargins[] = {0, 64};
+
+    const struct {
+        BoxShadowRenderer::Algorithm algorithm;
+        const char *name;
+    } algorithms[] = {
+        {BoxShadowRenderer::Algorithm::BoxBlur, "boxblur"},
+        {BoxShadowRenderer::Algorithm::AnalyticGaussian, "analytic"},
+    };
+
+    QVector<Result> results;
+    for (int preset = 1; preset < int(sizeof(s_shadowParams) / sizeof(s_shadowParams[0])); ++preset) {
+        for (const qreal scale : scales) {
+            for (const qreal dpr : dprs) {
+                for (const int boxMargin : boxMargins) {
+                    for (const auto &algorithm : algorithms) {
+                        BoxShadowRenderer renderer;
+                        renderer.setAlgorithm(algorithm.algorithm);
+                        setupRenderer(renderer, s_shadowParams[preset], scale, dpr, boxMargin);
+
+                        const QImage image = renderer.render();
+
+                        Result result;
+                        result.name = QStringLiteral("render/%1/scale%2/dpr%3/box+%4/%5")
+                            .arg(QLatin1String(presetNames[preset]))
+                            .arg(scale)
+                            .arg(dpr)
+                            .arg(boxMargin)
+                            .arg(QLatin1String(algorithm.name));
+                        result.pixels = qint64(image.width()) * image.height();
+                        result.nsPerRun = measure([&renderer] { renderer.render(); }, minTime);
+                        result.nsPerPixel = result.nsPerRun / qMax<qint64>(1, result.pixels);
+                        result.allocationsPerRun = countAllocations([&renderer] { renderer.render(); });
+                        result.imageBytes = image.sizeInBytes();
+                        results.append(result);
+                    }
+                }
+            }
+        }
+    }
+
+    return results;
+}
+
+/**
+ * Render each shadow preset with both algorithms.
+ *
+ * @returns The maximum and RMS difference of the shadow alpha, in 8 bit levels.
+ **/
+QVector<Comparison> compareAlgorithms()
+{
+    const char *const presetNames[] = {"none", "small", "medium", "large", "verylarge"};
+    const qreal scales[] = {1.0, 1.5, 2.0};
+    const qreal dprs[] = {1.0, 1.5, 2.0, 3.0};
+
+    QVector<Comparison> comparisons;
+    for (int preset = 1; preset < int(sizeof(s_shadowParams) / sizeof(s_shadowParams[0])); ++preset) {
+        for (const qreal scale : scales) {
+            for (const qreal dpr : dprs) {
+                BoxShadowRenderer boxBlurRenderer;
+                boxBlurRenderer.setAlgorithm(BoxShadowRenderer::Algorithm::BoxBlur);
+                setupRenderer(boxBlurRenderer, s_shadowParams[preset], scale, dpr, 0);
+
+                BoxShadowRenderer analyticRenderer;
+                analyticRenderer.setAlgorithm(BoxShadowRenderer::Algorithm::AnalyticGaussian);
+                setupRenderer(analyticRenderer, s_shadowParams[preset], scale, dpr, 0);
+
+                const QImage boxBlurImage = boxBlurRenderer.render();
+                const QImage analyticImage = analyticRenderer.render();
+                Q_ASSERT(boxBlurImage.size() == analyticImage.size());
+
+                Comparison comparison;
+                comparison.name = QStringLiteral("%1/scale%2/dpr%3")
+                    .arg(QLatin1String(presetNames[preset]))
+                    .arg(scale)
+                    .arg(dpr);
+
+                qreal sumOfSquares = 0;
+                for (int y = 0; y < boxBlurImage.height(); ++y) {
+                    const QRgb *boxBlurLine = reinterpret_cast<const QRgb *>(boxBlurImage.constScanLine(y));
+                    const QRgb *analyticLine = reinterpret_cast<const QRgb *>(analyticImage.constScanLine(y));
+                    for (int x = 0; x < boxBlurImage.width(); ++x) {
+                        const int difference = qAbs(qAlpha(boxBlurLine[x]) - qAlpha(analyticLine[x]));
+                        comparison.maxDifference = qMax(comparison.maxDifference, difference);
+                        sumOfSquares += difference * difference;
+                    }
+                }
+
+                const qint64 pixels = qMax<qint64>(1, qint64(boxBlurImage.width()) * boxBlurImage.height());
+                comparison.rmsDifference = qSqrt(sumOfSquares / pixels);
+                comparisons.append(comparison);
+            }
+        }
+    }
+
+    return comparisons;
+}
+
+QVector<Result> runBlurBenchmarks(int minTime)
+{
+    const QSize sizes[] = {QSize(64, 64), QSize(256, 256), QSize(1024, 1024), QSize(1920, 64)};
+    const int radii[] = {4, 16, 64};
+
+    QVector<Result> results;
+    for (const QSize &size : sizes) {
+        const int width = size.width();
+        const int height = size.height();
+
+        std::vector<uint8_t> src(width * height);
+        std::vector<uint8_t> dst(width * height);
+        for (int i = 0; i < int(src.size()); ++i) {
+            src[i] = uint8_t((i * 7) ^ (i >> 5));
+        }
+
+        QImage image(size, QImage::Format_Alpha8);
+        for (int y = 0; y < height; ++y) {
+            std::copy_n(src.data() + y * width, width, image.scanLine(y));
+        }
+
+        for (const int radius : radii) {
+            // the entry point used by the renderer, horizontal and vertical passes included
+            Result blur;
+            blur.name = QStringLiteral("blur/full/%1x%2/r%3").arg(width).arg(height).arg(radius);
+            blur.pixels = qint64(width) * height;
+            blur.nsPerRun = measure([&] { boxBlurAlpha(image, radius); }, minTime);
+            blur.nsPerPixel = blur.nsPerRun / blur.pixels;
+            blur.allocationsPerRun = countAllocations([&] { boxBlurAlpha(image, radius); });
+            results.append(blur);
+
+            // the vertical pass alone
+            const BoxLobes lobes = {radius, radius};
+
+            Result result;
+            result.name = QStringLiteral("blur/columns/%1x%2/r%3").arg(width).arg(height).arg(radius);
+            result.pixels = qint64(width) * height;
+            result.nsPerRun = measure([&] {
+                boxBlurColumnsAlpha(src.data(), width, dst.data(), width, width, height, lobes);
+            }, minTime);
+            result.nsPerPixel = result.nsPerRun / result.pixels;
+            result.allocationsPerRun = countAllocations([&] {
+                boxBlurColumnsAlpha(src.data(), width, dst.data(), width, width, height, lobes);
+            });
+            results.append(result);
+        }
+    }
+
+    return results;
+}
+
+/**
+ * @returns The ns/pixel of each benchmark in the given baseline file, by name.
+ **/
+QHash<QString, qreal> readBaseline(const QString &fileName, QString *error)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = file.errorString();
+        return {};
+    }
+
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (document.isNull()) {
+        *error = parseError.errorString();
+        return {};
+    }
+
+    QHash<QString, qreal> baseline;
+    const QJsonArray results = document.object().value(QStringLiteral("results")).toArray();
+    for (const QJsonValue &value : results) {
+        const QJsonObject result = value.toObject();
+        baseline.insert(result.value(QStringLiteral("name")).toString(),
+                        result.value(QStringLiteral("nsPerPixel")).toDouble());
+    }
+
+    return baseline;
+}
+
+QJsonDocument toJson(const QVector<Result> &results)
+{
+    QJsonArray array;
+    for (const Result &result : results) {
+        QJsonObject object;
+        object.insert(QStringLiteral("name"), result.name);
+        object.insert(QStringLiteral("pixels"), result.pixels);
+        object.insert(QStringLiteral("nsPerRun"), result.nsPerRun);
+        object.insert(QStringLiteral("nsPerPixel"), result.nsPerPixel);
+        object.insert(QStringLiteral("allocationsPerRun"), result.allocationsPerRun);
+        object.insert(QStringLiteral("imageBytes"), result.imageBytes);
+        array.append(object);
+    }
+
+    QJsonObject root;
+    root.insert(QStringLiteral("blurBackend"), QLatin1String(boxBlurBackendName()));
+    root.insert(QStringLiteral("peakRssKiB"), peakRssKiB());
+    root.insert(QStringLiteral("results"), array);
+    return QJsonDocument(root);
+}
+
+QJsonDocument toJson(const QVector<Comparison> &comparisons)
+{
+    QJsonArray array;
+    for (const Comparison &comparison : comparisons) {
+        QJsonObject object;
+        object.insert(QStringLiteral("name"), comparison.name);
+        object.insert(QStringLiteral("maxDifference"), comparison.maxDifference);
+        object.insert(QStringLiteral("rmsDifference"), comparison.rmsDifference);
+        array.append(object);
+    }
+
+    QJsonObject root;
+    root.insert(QStringLiteral("comparisons"), array);
+    return QJsonDocument(root);
+}
+
+/**
+ * Write the document to the given file.
+ *
+ * @returns false, with an error message, if the file cannot be written.
+ **/
+bool writeJson(const QString &fileName, const QJsonDocument &document, QTextStream &err)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        err << "cannot write " << file.fileName() << ": " << file.errorString() << Qt::endl;
+        return false;
+    }
+
+    file.write(document.toJson());
+    return true;
+}
+
+} // namespace
+
+// count allocations, including those made from Qt. Image buffers are allocated with malloc,
+// so they are reported separately
+void *operator new(std::size_t size)
+{
+    s_allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *pointer = std::malloc(size ? size : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("breezeenhanced_bench"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Benchmark shadow rendering and the blur kernels."));
+    parser.addHelpOption();
+
+    const QCommandLineOption outputOption(QStringLiteral("output"),
+        QStringLiteral("Write the results as JSON to <file>."), QStringLiteral("file"));
+    const QCommandLineOption baselineOption(QStringLiteral("baseline"),
+        QStringLiteral("Compare the results against the JSON <file> written by a previous run."), QStringLiteral("file"));
+    const QCommandLineOption thresholdOption(QStringLiteral("threshold"),
+        QStringLiteral("Slowdown, in percent, reported as a regression. Defaults to 10."), QStringLiteral("percent"), QStringLiteral("10"));
+    const QCommandLineOption minTimeOption(QStringLiteral("min-time"),
+        QStringLiteral("Minimum time spent on each benchmark, in milliseconds. Defaults to 100."), QStringLiteral("ms"), QStringLiteral("100"));
+    const QCommandLineOption filterOption(QStringLiteral("filter"),
+        QStringLiteral("Only run benchmarks whose name starts with <prefix>: render or blur."), QStringLiteral("prefix"));
+    const QCommandLineOption compareOption(QStringLiteral("compare-algorithms"),
+        QStringLiteral("Instead of measuring, report the alpha difference between the box blur and the analytic Gaussian shadows."));
+    const QCommandLineOption maxDifferenceOption(QStringLiteral("max-difference"),
+        QStringLiteral("With --compare-algorithms, fail if the alpha of a shadow differs by more than <levels>."), QStringLiteral("levels"));
+    parser.addOptions({outputOption, baselineOption, thresholdOption, minTimeOption, filterOption, compareOption, maxDifferenceOption});
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    if (parser.isSet(compareOption)) {
+        const QVector<Comparison> comparisons = compareAlgorithms();
+        const int maxDifference = parser.isSet(maxDifferenceOption) ? parser.value(maxDifferenceOption).toInt() : 255;
+
+        int failures = 0;
+        for (const Comparison &comparison : comparisons) {
+            out << qSetFieldWidth(32) << Qt::left << comparison.name << qSetFieldWidth(0)
+                << "max " << comparison.maxDifference << ", rms " << QString::number(comparison.rmsDifference, 'f', 3);
+            if (comparison.maxDifference > maxDifference) {
+                out << "  DIFFERS";
+                ++failures;
+            }
+            out << Qt::endl;
+        }
+
+        if (parser.isSet(outputOption) && !writeJson(parser.value(outputOption), toJson(comparisons), err)) {
+            return 2;
+        }
+
+        if (failures > 0) {
+            err << failures << " shadow(s) differ by more than " << maxDifference << " alpha levels" << Qt::endl;
+            return 1;
+        }
+
+        return 0;
+    }
+
+    const int minTime = parser.value(minTimeOption).toInt();
+    const qreal threshold = parser.value(thresholdOption).toDouble() / 100.0;
+    const QString filter = parser.value(filterOption);
+
+    QHash<QString, qreal> baseline;
+    if (parser.isSet(baselineOption)) {
+        QString error;
+        baseline = readBaseline(parser.value(baselineOption), &error);
+        if (!error.isEmpty()) {
+            err << "cannot read baseline " << parser.value(baselineOption) << ": " << error << Qt::endl;
+            return 2;
+        }
+    }
+
+    // a benchmark group runs if the filter selects some of its benchmarks
+    auto runs = [&filter](const QString &group) {
+        return filter.isEmpty() || group.startsWith(filter) || filter.startsWith(group);
+    };
+
+    QVector<Result> results;
+    if (runs(QStringLiteral("render"))) {
+        results += runShadowBenchmarks(minTime);
+    }
+    if (runs(QStringLiteral("blur"))) {
+        results += runBlurBenchmarks(minTime);
+    }
+
+    results.erase(std::remove_if(results.begin(), results.end(), [&filter](const Result &result) {
+        return !result.name.startsWith(filter);
+    }), results.end());
+
+    int regressions = 0;
+    for (const Result &result : qAsConst(results)) {
+        out << qSetFieldWidth(48) << Qt::left << result.name << qSetFieldWidth(0)
+            << QString::number(result.nsPerPixel, 'f', 3) << " ns/pixel";
+
+        const auto iter = baseline.constFind(result.name);
+        if (iter != baseline.constEnd() && iter.value() > 0) {
+            const qreal ratio = result.nsPerPixel / iter.value();
+            out << "  " << (ratio >= 1 ? "+" : "") << QString::number((ratio - 1) * 100, 'f', 1) << "%";
+            if (ratio > 1 + threshold) {
+                out << "  REGRESSION";
+                ++regressions;
+            }
+        }
+
+        out << Qt::endl;
+    }
+
+    out << "blur backend: " << boxBlurBackendName() << ", peak RSS: " << peakRssKiB() << " KiB" << Qt::endl;
+
+    if (parser.isSet(outputOption) && !writeJson(parser.value(outputOption), toJson(results), err)) {
+        return 2;
+    }
+
+    if (regressions > 0) {
+        err << regressions << " benchmark(s) slower than the baseline by more than "
+            << parser.value(thresholdOption) << "%" << Qt::endl;
+        return 1;
+    }
+
+    return 0;
+}
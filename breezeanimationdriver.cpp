@@ -0,0 +1,140 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "breezeanimationdriver.h"
+#include "breezeperformancecounters.h"
+
+#include <KDecoration2/Decoration>
+
+#include <QEasingCurve>
+#include <QHash>
+
+namespace Breeze
+{
+
+    AnimationDriver *AnimationDriver::s_self = nullptr;
+
+    //__________________________________________________________________
+    AnimationDriver::AnimationDriver():
+        m_clock( this )
+    {}
+
+    //__________________________________________________________________
+    AnimationDriver *AnimationDriver::self()
+    {
+        if( !s_self )
+        { s_self = new AnimationDriver(); }
+
+        return s_self;
+    }
+
+    //__________________________________________________________________
+    void AnimationDriver::animate( QObject *target, KDecoration2::Decoration *decoration, bool forward, int duration, const Callback& callback )
+    {
+
+        // reverse running animation
+        for( Tween& tween : m_tweens )
+        {
+            if( tween.target != target ) continue;
+            tween.forward = forward;
+            tween.duration = duration;
+            tween.callback = callback;
+            return;
+        }
+
+        Tween tween;
+        tween.target = target;
+        tween.decoration = decoration;
+        tween.callback = callback;
+        tween.progress = forward ? 0:1;
+        tween.forward = forward;
+        tween.duration = duration;
+        m_tweens.append( tween );
+
+        if( m_clock.state() != QAbstractAnimation::Running )
+        {
+            m_lastTime = 0;
+            m_clock.start();
+        }
+
+        const QRect rect( callback( easedValue( tween.progress ) ) );
+        if( decoration && !rect.isEmpty() ) decoration->update( rect );
+
+    }
+
+    //__________________________________________________________________
+    bool AnimationDriver::isAnimating( const QObject *target ) const
+    {
+        for( const Tween& tween : m_tweens )
+        { if( tween.target == target ) return true; }
+
+        return false;
+    }
+
+    //__________________________________________________________________
+    void AnimationDriver::tick( int time )
+    {
+
+        const int elapsed = time - m_lastTime;
+        m_lastTime = time;
+        if( elapsed <= 0 ) return;
+
+        PerformanceCounters::self()->increment( PerformanceCounters::AnimationTicks );
+
+        // finished animations are removed before notifying,
+        // so that targets already see they are no longer animated
+        QVector<Tween> tweens;
+        tweens.swap( m_tweens );
+        for( Tween& tween : tweens )
+        {
+
+            // target was deleted
+            if( !( tween.target && tween.decoration ) ) continue;
+
+            const qreal step = tween.duration > 0 ? qreal( elapsed )/tween.duration : 1;
+            tween.progress = qBound<qreal>( 0, tween.progress + ( tween.forward ? step:-step ), 1 );
+            if( tween.forward ? tween.progress < 1 : tween.progress > 0 ) m_tweens.append( tween );
+
+        }
+
+        // the clock is stopped from within its own update, which Qt allows
+        if( m_tweens.isEmpty() ) m_clock.stop();
+
+        // apply values, and collect the areas to repaint per decoration
+        QHash<KDecoration2::Decoration*, QRect> dirtyRects;
+        for( const Tween& tween : tweens )
+        {
+            if( !( tween.target && tween.decoration ) ) continue;
+            const QRect rect( tween.callback( easedValue( tween.progress ) ) );
+            if( !rect.isEmpty() ) dirtyRects[tween.decoration.data()] |= rect;
+        }
+
+        // one repaint per decoration
+        for( auto iter = dirtyRects.constBegin(); iter != dirtyRects.constEnd(); ++iter )
+        { iter.key()->update( iter.value() ); }
+
+    }
+
+    //__________________________________________________________________
+    qreal AnimationDriver::easedValue( qreal progress )
+    {
+        static const QEasingCurve easingCurve( QEasingCurve::InOutQuad );
+        return easingCurve.valueForProgress( progress );
+    }
+
+}
@@ -0,0 +1,128 @@
+#ifndef breezeanimationdriver_h
+#define breezeanimationdriver_h
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QAbstractAnimation>
+#include <QPointer>
+#include <QRect>
+#include <QVector>
+
+#include <functional>
+
+namespace KDecoration2
+{
+    class Decoration;
+}
+
+namespace Breeze
+{
+
+    //* drives the active state and hover animations of all decorations and their buttons
+    /**
+    running animations are kept in a flat list and stepped in one pass by a single clock,
+    which only runs while there is something to animate. The clock is a QAbstractAnimation,
+    so that it ticks together with every other animation in the process. Repaints are
+    collected and each decoration is updated at most once per frame.
+    */
+    class AnimationDriver
+    {
+
+        public:
+
+        //* applies the eased animation value, between 0 and 1, and returns the area to repaint
+        using Callback = std::function<QRect( qreal )>;
+
+        //* singleton
+        static AnimationDriver *self();
+
+        //* animate given target, part of given decoration, towards 1 if forward, towards 0 otherwise
+        /**
+        a running animation of the same target is reversed from its current value.
+        Otherwise the animation starts from the opposite end, like QVariantAnimation does
+        */
+        void animate( QObject *target, KDecoration2::Decoration*, bool forward, int duration, const Callback& );
+
+        //* true if given target is being animated
+        bool isAnimating( const QObject *target ) const;
+
+        private:
+
+        //* constructor
+        AnimationDriver();
+
+        //* step all running animations, given the time since the clock started
+        void tick( int time );
+
+        //* animation value for given linear progress
+        static qreal easedValue( qreal );
+
+        //* clock, driven by the Qt animation timer
+        class Clock: public QAbstractAnimation
+        {
+            public:
+
+            explicit Clock( AnimationDriver *driver ):
+                m_driver( driver )
+            {}
+
+            int duration() const override
+            { return -1; }
+
+            protected:
+
+            void updateCurrentTime( int time ) override
+            { m_driver->tick( time ); }
+
+            private:
+
+            AnimationDriver *m_driver;
+
+        };
+
+        //* running animation
+        struct Tween
+        {
+            QPointer<QObject> target;
+            QPointer<KDecoration2::Decoration> decoration;
+            Callback callback;
+
+            //* linear progress, between 0 and 1
+            qreal progress = 0;
+            bool forward = true;
+            int duration = 0;
+        };
+
+        //* running animations
+        QVector<Tween> m_tweens;
+
+        //* clock
+        Clock m_clock;
+
+        //* clock time of the last step
+        int m_lastTime = 0;
+
+        //* singleton
+        static AnimationDriver *s_self;
+
+    };
+
+}
+
+#endif
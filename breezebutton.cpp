@@ -19,13 +19,16 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include "breezebutton.h"
+#include "breezeanimationdriver.h"
+#include "breezeperformancecounters.h"
+#include "breezetracer.h"
 
 #include <KDecoration2/DecoratedClient>
 #include <KColorUtils>
 //#include <KIconLoader>
 
+#include <QCache>
 #include <QPainter>
-#include <QVariantAnimation>
 #include <QPainterPath>
 
 namespace Breeze
@@ -35,23 +38,61 @@ namespace Breeze
     using KDecoration2::ColorGroup;
     using KDecoration2::DecorationButtonType;
 
+    namespace
+    {
+
+        //* key to the button icon cache
+        struct ButtonIconKey
+        {
+
+            //* button state flags
+            enum Flag
+            {
+                Hovered = 1<<0,
+                Pressed = 1<<1,
+                Checked = 1<<2,
+                Active = 1<<3,
+                Animated = 1<<4,
+                MacOSButtons = 1<<5
+            };
+
+            int type = 0;
+            int flags = 0;
+            int animationStep = 0;
+            QRgb titleBarColor = 0;
+            QRgb fontColor = 0;
+            QRgb warningColor = 0;
+            int size = 0;
+            int devicePixelRatio = 0;
+
+        };
+
+        inline bool operator == (const ButtonIconKey &first, const ButtonIconKey &second)
+        {
+            return first.type == second.type
+                && first.flags == second.flags
+                && first.animationStep == second.animationStep
+                && first.titleBarColor == second.titleBarColor
+                && first.fontColor == second.fontColor
+                && first.warningColor == second.warningColor
+                && first.size == second.size
+                && first.devicePixelRatio == second.devicePixelRatio;
+        }
+
+        inline uint qHash(const ButtonIconKey &key, uint seed = 0)
+        { return qHashBits(&key, sizeof(ButtonIconKey), seed); }
+
+    }
+
+    //* pre-rendered button icons, shared by all decorations
+    static QCache<ButtonIconKey, QImage> g_buttonIcons( 512 );
+
 
     //__________________________________________________________________
     Button::Button(DecorationButtonType type, Decoration* decoration, QObject* parent)
         : DecorationButton(type, decoration, parent)
-        , m_animation( new QVariantAnimation( this ) )
     {
 
-        // setup animation
-        // It is important start and end value are of the same type, hence 0.0 and not just 0
-        m_animation->setStartValue( 0.0 );
-        m_animation->setEndValue( 1.0 );
-        m_animation->setEasingCurve( QEasingCurve::InOutQuad );
-        connect(m_animation, &QVariantAnimation::valueChanged, this, [this](const QVariant &value) {
-            setOpacity(value.toReal());
-        });
-
-
         // setup default geometry
         const int height = decoration->buttonHeight();
         setGeometry(QRect(0, 0, height, height));
@@ -59,11 +100,8 @@ namespace Breeze
 
         // connections
         connect(decoration->client().data(), SIGNAL(iconChanged(QIcon)), this, SLOT(update()));
-        connect(decoration->settings().data(), &KDecoration2::DecorationSettings::reconfigured, this, &Button::reconfigure);
         connect( this, &KDecoration2::DecorationButton::hoveredChanged, this, &Button::updateAnimationState );
 
-        reconfigure();
-
     }
 
     //__________________________________________________________________
@@ -128,17 +166,21 @@ namespace Breeze
     //__________________________________________________________________
     void Button::paint(QPainter *painter, const QRect &repaintRegion)
     {
-        Q_UNUSED(repaintRegion)
-
         if (!decoration()) return;
 
+        const Tracer::Span span( "Button::paint", decoration() );
+
+        if( !m_iconSize.isValid() ) m_iconSize = geometry().size().toSize();
+
+        // skip buttons outside of the damaged area
+        const QPointF offset( m_flag == FlagFirstInList ? m_offset : QPointF( 0, m_offset.y() ) );
+        const QRectF iconRect( geometry().topLeft() + offset, m_iconSize );
+        if( !geometry().united( iconRect ).toAlignedRect().intersects( repaintRegion ) ) return;
+
         painter->save();
 
         // translate from offset
-        if( m_flag == FlagFirstInList ) painter->translate( m_offset );
-        else painter->translate( 0, m_offset.y() );
-
-        if( !m_iconSize.isValid() ) m_iconSize = geometry().size().toSize();
+        painter->translate( offset );
 
         // menu button
         if (type() == DecorationButtonType::Menu)
@@ -175,18 +217,70 @@ namespace Breeze
     void Button::drawIcon( QPainter *painter ) const
     {
 
-        painter->setRenderHints( QPainter::Antialiasing );
+        const qreal width( m_iconSize.width() );
+        auto d = qobject_cast<Decoration*>( decoration() );
+        if( !d || width <= 0 )
+        {
+            painter->setRenderHints( QPainter::Antialiasing );
+            painter->translate( geometry().topLeft() );
+            painter->scale( width/20, width/20 );
+            painter->translate( 1, 1 );
+            renderIcon( painter );
+            return;
+        }
+
+        // icons only depend on the button state and on the decoration colors, and are shared by all decorations
+        auto c = d->client().data();
+        const qreal dpr = painter->device()->devicePixelRatioF();
+
+        ButtonIconKey key;
+        key.type = static_cast<int>( type() );
+        key.flags =
+            ( isHovered() ? ButtonIconKey::Hovered:0 ) |
+            ( isPressed() ? ButtonIconKey::Pressed:0 ) |
+            ( isChecked() ? ButtonIconKey::Checked:0 ) |
+            ( c->isActive() ? ButtonIconKey::Active:0 ) |
+            ( isAnimating() ? ButtonIconKey::Animated:0 ) |
+            ( d->internalSettings()->macOSButtons() ? ButtonIconKey::MacOSButtons:0 );
+        key.animationStep = qRound( m_opacity*AnimationSteps );
+        key.titleBarColor = d->titleBarColor().rgba();
+        key.fontColor = d->fontColor().rgba();
+        key.warningColor = c->color( ColorGroup::Warning, ColorRole::Foreground ).rgba();
+        key.size = m_iconSize.width();
+        key.devicePixelRatio = qRound( dpr*100 );
+
+        QImage *icon = g_buttonIcons.object( key );
+        PerformanceCounters::self()->increment( icon ? PerformanceCounters::ButtonIconHits:PerformanceCounters::ButtonIconMisses );
+        if( !icon )
+        {
+            icon = new QImage( QSize( key.size, key.size )*dpr, QImage::Format_ARGB32_Premultiplied );
+            icon->setDevicePixelRatio( dpr );
+            icon->fill( Qt::transparent );
+
+            /*
+            scale painter so that its window matches QRect( -1, -1, 20, 20 )
+            this makes all further rendering and scaling simpler
+            all further rendering is preformed inside QRect( 0, 0, 18, 18 )
+            */
+            QPainter iconPainter( icon );
+            iconPainter.setRenderHints( QPainter::Antialiasing );
+            iconPainter.scale( width/20, width/20 );
+            iconPainter.translate( 1, 1 );
+            renderIcon( &iconPainter );
+            iconPainter.end();
+
+            g_buttonIcons.insert( key, icon );
+        }
 
-        /*
-        scale painter so that its window matches QRect( -1, -1, 20, 20 )
-        this makes all further rendering and scaling simpler
-        all further rendering is preformed inside QRect( 0, 0, 18, 18 )
-        */
-        painter->translate( geometry().topLeft() );
+        painter->drawImage( QRectF( geometry().topLeft(), QSizeF( width, width ) ), *icon );
+
+    }
+
+    //__________________________________________________________________
+    void Button::renderIcon( QPainter *painter ) const
+    {
 
         const qreal width( m_iconSize.width() );
-        painter->scale( width/20, width/20 );
-        painter->translate( 1, 1 );
 
         // render background
         const QColor backgroundColor( this->backgroundColor() );
@@ -194,7 +288,7 @@ namespace Breeze
         auto d = qobject_cast<Decoration*>( decoration() );
         bool isInactive(d && !d->client().data()->isActive()
                         && !isHovered() && !isPressed()
-                        && m_animation->state() != QAbstractAnimation::Running);
+                        && !isAnimating());
         QColor inactiveCol(Qt::gray);
         if (isInactive)
         {
@@ -248,7 +342,7 @@ namespace Breeze
                             painter->setBrush( backgroundColor );
                             qreal r = static_cast<qreal>(7)
                                       + (isPressed() ? 0.0
-                                         : static_cast<qreal>(2) * m_animation->currentValue().toReal());
+                                         : static_cast<qreal>(2) * m_opacity);
                             QPointF c(static_cast<qreal>(9), static_cast<qreal>(9));
                             painter->drawEllipse( c, r, r );
                         }
@@ -304,7 +398,7 @@ namespace Breeze
                             painter->setBrush( backgroundColor );
                             qreal r = static_cast<qreal>(7)
                                       + (isPressed() ? 0.0
-                                         : static_cast<qreal>(2) * m_animation->currentValue().toReal());
+                                         : static_cast<qreal>(2) * m_opacity);
                             QPointF c(static_cast<qreal>(9), static_cast<qreal>(9));
                             painter->drawEllipse( c, r, r );
                         }
@@ -364,7 +458,7 @@ namespace Breeze
                             painter->setBrush( backgroundColor );
                             qreal r = static_cast<qreal>(7)
                                       + (isPressed() ? 0.0
-                                         : static_cast<qreal>(2) * m_animation->currentValue().toReal());
+                                         : static_cast<qreal>(2) * m_opacity);
                             QPointF c(static_cast<qreal>(9), static_cast<qreal>(9));
                             painter->drawEllipse( c, r, r );
                         }
@@ -420,7 +514,7 @@ namespace Breeze
                                 painter->setPen( Qt::NoPen );
                                 painter->setBrush( backgroundColor );
                                 qreal r = static_cast<qreal>(7)
-                                          + static_cast<qreal>(2) * m_animation->currentValue().toReal();
+                                          + static_cast<qreal>(2) * m_opacity;
                                 QPointF c(static_cast<qreal>(9), static_cast<qreal>(9));
                                 painter->drawEllipse( c, r, r );
                             }
@@ -500,7 +594,7 @@ namespace Breeze
                                 painter->setPen( Qt::NoPen );
                                 painter->setBrush( backgroundColor );
                                 qreal r = static_cast<qreal>(7)
-                                          + static_cast<qreal>(2) * m_animation->currentValue().toReal();
+                                          + static_cast<qreal>(2) * m_opacity;
                                 QPointF c(static_cast<qreal>(9), static_cast<qreal>(9));
                                 painter->drawEllipse( c, r, r );
                             }
@@ -565,7 +659,7 @@ namespace Breeze
                                 painter->setPen( Qt::NoPen );
                                 painter->setBrush( backgroundColor );
                                 qreal r = static_cast<qreal>(7)
-                                          + static_cast<qreal>(2) * m_animation->currentValue().toReal();
+                                          + static_cast<qreal>(2) * m_opacity;
                                 QPointF c(static_cast<qreal>(9), static_cast<qreal>(9));
                                 painter->drawEllipse( c, r, r );
                             }
@@ -638,7 +732,7 @@ namespace Breeze
                                 painter->setPen( Qt::NoPen );
                                 painter->setBrush( backgroundColor );
                                 qreal r = static_cast<qreal>(7)
-                                          + static_cast<qreal>(2) * m_animation->currentValue().toReal();
+                                          + static_cast<qreal>(2) * m_opacity;
                                 QPointF c(static_cast<qreal>(9), static_cast<qreal>(9));
                                 painter->drawEllipse( c, r, r );
                             }
@@ -708,7 +802,7 @@ namespace Breeze
                             painter->setPen( Qt::NoPen );
                             painter->setBrush( backgroundColor );
                             qreal r = static_cast<qreal>(7)
-                                      + static_cast<qreal>(2) * m_animation->currentValue().toReal();
+                                      + static_cast<qreal>(2) * m_opacity;
                             QPointF c(static_cast<qreal>(9), static_cast<qreal>(9));
                             painter->drawEllipse( c, r, r );
                         }
@@ -764,7 +858,7 @@ namespace Breeze
                             painter->setPen( Qt::NoPen );
                             painter->setBrush( backgroundColor );
                             qreal r = static_cast<qreal>(7)
-                                      + static_cast<qreal>(2) * m_animation->currentValue().toReal();
+                                      + static_cast<qreal>(2) * m_opacity;
                             QPointF c(static_cast<qreal>(9), static_cast<qreal>(9));
                             painter->drawEllipse( c, r, r );
                         }
@@ -807,7 +901,7 @@ namespace Breeze
             QColor col;
             if (d && !d->client().data()->isActive()
                 && !isHovered() && !isPressed()
-                && m_animation->state() != QAbstractAnimation::Running)
+                && !isAnimating())
             {
                 int v = qGray(inactiveCol.rgb());
                 if (v > 127) v -= 127;
@@ -839,7 +933,7 @@ namespace Breeze
 
             return d->titleBarColor();
 
-        } else if( m_animation->state() == QAbstractAnimation::Running ) {
+        } else if( isAnimating() ) {
 
             return KColorUtils::mix( d->fontColor(), d->titleBarColor(), m_opacity );
 
@@ -906,7 +1000,7 @@ namespace Breeze
                     return col;
                 else return KColorUtils::mix( d->titleBarColor(), d->fontColor(), 0.3 );
 
-            } else if( m_animation->state() == QAbstractAnimation::Running ) {
+            } else if( isAnimating() ) {
 
                 QColor col;
                 if( type() == DecorationButtonType::Close )
@@ -1022,7 +1116,7 @@ namespace Breeze
                         col = QColor(255, 255, 255, 180);
                     return col;
 
-            } else if( m_animation->state() == QAbstractAnimation::Running ) {
+            } else if( isAnimating() ) {
 
                 if( type() == DecorationButtonType::Close )
                 {
@@ -1067,14 +1161,10 @@ namespace Breeze
 
     }
 
-    //________________________________________________________________
-    void Button::reconfigure()
+    //__________________________________________________________________
+    bool Button::isAnimating() const
     {
-
-        // animation
-        auto d = qobject_cast<Decoration*>(decoration());
-        if( d )  m_animation->setDuration( d->internalSettings()->animationsDuration() );
-
+        return AnimationDriver::self()->isAnimating( this );
     }
 
     //__________________________________________________________________
@@ -1084,11 +1174,16 @@ namespace Breeze
         auto d = qobject_cast<Decoration*>(decoration());
         if( !(d && d->internalSettings()->animationsEnabled() ) ) return;
 
-        QAbstractAnimation::Direction dir = hovered ? QAbstractAnimation::Forward : QAbstractAnimation::Backward;
-        if( m_animation->state() == QAbstractAnimation::Running && m_animation->direction() != dir )
-            m_animation->stop();
-        m_animation->setDirection( dir );
-        if( m_animation->state() != QAbstractAnimation::Running ) m_animation->start();
+        AnimationDriver::self()->animate( this, d, hovered, d->internalSettings()->animationsDuration(),
+            [this]( qreal value )
+            {
+                // animation frames are quantized so that button icons can be cached,
+                // and the button is only repainted when the frame changes
+                const qreal opacity = qRound( value*AnimationSteps )/static_cast<qreal>( AnimationSteps );
+                if( m_opacity == opacity ) return QRect();
+                m_opacity = opacity;
+                return geometry().toAlignedRect();
+            } );
 
     }
 
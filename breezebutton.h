@@ -27,8 +27,6 @@
 #include <QHash>
 #include <QImage>
 
-class QVariantAnimation;
-
 namespace Breeze
 {
 
@@ -98,9 +96,6 @@ namespace Breeze
 
         private Q_SLOTS:
 
-        //* apply configuration changes
-        void reconfigure();
-
         //* animation state
         void updateAnimationState(bool);
 
@@ -109,9 +104,18 @@ namespace Breeze
         //* private constructor
         explicit Button(KDecoration2::DecorationButtonType type, Decoration *decoration, QObject *parent = nullptr);
 
-        //* draw button icon
+        //* true if the hover animation is running
+        bool isAnimating() const;
+
+        //* draw button icon, from the shared icon cache whenever possible
         void drawIcon( QPainter *) const;
 
+        //* render button icon, in a 20x20 painter window
+        void renderIcon( QPainter *) const;
+
+        //* number of distinct hover animation frames
+        enum { AnimationSteps = 16 };
+
         //*@name colors
         //@{
         QColor foregroundColor(const QColor& inactiveCol) const;
@@ -120,9 +124,6 @@ namespace Breeze
 
         Flag m_flag = FlagNone;
 
-        //* active state change animation
-        QVariantAnimation *m_animation;
-
         //* vertical offset (for rendering)
         QPointF m_offset;
 
@@ -26,8 +26,12 @@
 #include "config-breeze.h"
 #include "config/breezeconfigwidget.h"
 
+#include "breezeanimationdriver.h"
 #include "breezebutton.h"
-#include "breezesizegrip.h"
+#include "breezeperformancecounters.h"
+#include "breezeshadowparams.h"
+#include "breezetracer.h"
+#include "breezewindowinfocache.h"
 
 #include "breezeboxshadowrenderer.h"
 
@@ -41,17 +45,17 @@
 #include <KSharedConfig>
 #include <KPluginFactory>
 
+#include <QCache>
+#include <QFontDatabase>
+#include <QGuiApplication>
+#include <QHash>
 #include <QPainter>
-#include <QTextStream>
 #include <QTimer>
-#include <QVariantAnimation>
 
 #include <QProcessEnvironment>
 #include <QDebug>
  
-#if BREEZE_HAVE_X11
-#include <QX11Info>
-#endif
+#include <QtMath>
 
 #include <cmath>
 
@@ -65,66 +69,8 @@ K_PLUGIN_FACTORY_WITH_JSON(
 
 namespace
 {
-    struct ShadowParams {
-        ShadowParams()
-            : offset(QPoint(0, 0))
-            , radius(0)
-            , opacity(0) {}
-
-        ShadowParams(const QPoint &offset, int radius, qreal opacity)
-            : offset(offset)
-            , radius(radius)
-            , opacity(opacity) {}
-
-        QPoint offset;
-        int radius;
-        qreal opacity;
-    };
-
-    struct CompositeShadowParams {
-        CompositeShadowParams() = default;
-
-        CompositeShadowParams(
-                const QPoint &offset,
-                const ShadowParams &shadow1,
-                const ShadowParams &shadow2)
-            : offset(offset)
-            , shadow1(shadow1)
-            , shadow2(shadow2) {}
-
-        bool isNone() const {
-            return qMax(shadow1.radius, shadow2.radius) == 0;
-        }
-
-        QPoint offset;
-        ShadowParams shadow1;
-        ShadowParams shadow2;
-    };
-
-    const CompositeShadowParams s_shadowParams[] = {
-        // None
-        CompositeShadowParams(),
-        // Small
-        CompositeShadowParams(
-            QPoint(0, 4),
-            ShadowParams(QPoint(0, 0), 16, 1),
-            ShadowParams(QPoint(0, -2), 8, 0.4)),
-        // Medium
-        CompositeShadowParams(
-            QPoint(0, 8),
-            ShadowParams(QPoint(0, 0), 32, 0.9),
-            ShadowParams(QPoint(0, -4), 16, 0.3)),
-        // Large
-        CompositeShadowParams(
-            QPoint(0, 12),
-            ShadowParams(QPoint(0, 0), 48, 0.8),
-            ShadowParams(QPoint(0, -6), 24, 0.2)),
-        // Very large
-        CompositeShadowParams(
-            QPoint(0, 16),
-            ShadowParams(QPoint(0, 0), 64, 0.7),
-            ShadowParams(QPoint(0, -8), 32, 0.1)),
-    };
+    using Breeze::CompositeShadowParams;
+    using Breeze::s_shadowParams;
 
     inline CompositeShadowParams lookupShadowParams(int size)
     {
@@ -144,6 +90,111 @@ namespace
             return s_shadowParams[3];
         }
     }
+
+    //* key to the title bar background tile cache
+    struct TitleBarTileKey
+    {
+
+        //* shape flags
+        enum Flag
+        {
+            Maximized = 1<<0,
+            AlphaChannel = 1<<1,
+            Shaded = 1<<2,
+            LeftEdge = 1<<3,
+            TopEdge = 1<<4,
+            RightEdge = 1<<5,
+            Antialiasing = 1<<6
+        };
+
+        QRgb color = 0;
+        int gradientIntensity = 0;
+        int height = 0;
+        int scale = 0;
+        int devicePixelRatio = 0;
+        int flags = 0;
+
+    };
+
+    inline bool operator == (const TitleBarTileKey &first, const TitleBarTileKey &second)
+    {
+        return first.color == second.color
+            && first.gradientIntensity == second.gradientIntensity
+            && first.height == second.height
+            && first.scale == second.scale
+            && first.devicePixelRatio == second.devicePixelRatio
+            && first.flags == second.flags;
+    }
+
+    inline uint qHash(const TitleBarTileKey &key, uint seed = 0)
+    {
+        return qHashBits(&key, sizeof(TitleBarTileKey), seed);
+    }
+
+    //* key to the shadow cache
+    struct ShadowKey
+    {
+        int size = 0;
+        int strength = 0;
+        QRgb color = 0;
+        int scale = 0;
+        int devicePixelRatio = 0;
+
+        //* size grip color, 0 when the window has no size grip
+        QRgb sizeGripColor = 0;
+    };
+
+    inline bool operator == (const ShadowKey &first, const ShadowKey &second)
+    {
+        return first.size == second.size
+            && first.strength == second.strength
+            && first.color == second.color
+            && first.scale == second.scale
+            && first.devicePixelRatio == second.devicePixelRatio
+            && first.sizeGripColor == second.sizeGripColor;
+    }
+
+    inline uint qHash(const ShadowKey &key, uint seed = 0)
+    {
+        return qHashBits(&key, sizeof(ShadowKey), seed);
+    }
+
+    //* draw the size grip into the shadow texture, just outside the bottom right corner of the window
+    /**
+    the texture is extended when the shadow does not reach far enough, and the padding with it.
+    An empty texture, for windows without shadow, is created with room for the grip only
+    */
+    void drawSizeGrip(QImage &texture, QMargins &padding, int size, const QColor &color)
+    {
+        if (texture.isNull()) {
+            texture = QImage(2*size + 1, 2*size + 1, QImage::Format_ARGB32_Premultiplied);
+            texture.fill(Qt::transparent);
+            padding = QMargins(0, 0, size, size);
+        } else if (padding.right() < size || padding.bottom() < size) {
+            const QMargins extension(0, 0, qMax(0, size - padding.right()), qMax(0, size - padding.bottom()));
+            QImage extended(texture.size() + QSize(extension.right(), extension.bottom()), QImage::Format_ARGB32_Premultiplied);
+            extended.fill(Qt::transparent);
+
+            QPainter painter(&extended);
+            painter.drawImage(QPoint(0, 0), texture);
+            painter.end();
+
+            texture = extended;
+            padding += extension;
+        }
+
+        // the window corner, in texture coordinates
+        const QPoint corner(texture.width() - padding.right(), texture.height() - padding.bottom());
+
+        QPainter painter(&texture);
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(color);
+        painter.drawPolygon(QVector<QPoint> {
+            corner,
+            corner + QPoint(size, 0),
+            corner + QPoint(0, size)});
+    }
 }
 
 namespace Breeze
@@ -154,49 +205,37 @@ namespace Breeze
 
     //________________________________________________________________
     static int g_sDecoCount = 0;
-    static int g_shadowSizeEnum = InternalSettings::ShadowLarge;
-    static int g_shadowStrength = 255;
-    static QColor g_shadowColor = Qt::black;
-    static QSharedPointer<KDecoration2::DecorationShadow> g_sShadow;
-    float scaleFactor;
+
+    //* shadows, shared by all decorations with the same settings and device pixel ratio
+    static QHash<ShadowKey, QSharedPointer<KDecoration2::DecorationShadow>> g_shadows;
+
+    //* maximum number of cached shadows, decorations keep their own reference anyway
+    static const int g_maxShadowCount = 16;
+
+    //* pre-rendered title bar backgrounds, shared by all decorations
+    static QCache<TitleBarTileKey, QImage> g_titleBarTiles( 256 );
 
     //________________________________________________________________
     Decoration::Decoration(QObject *parent, const QVariantList &args)
         : KDecoration2::Decoration(parent, args)
-        , m_animation( new QVariantAnimation( this ) )
+        , m_devicePixelRatio( qGuiApp ? qGuiApp->devicePixelRatio() : 1.0 )
     {
         g_sDecoCount++;
+        PerformanceCounters::self()->increment( PerformanceCounters::DecorationsCreated );
     }
 
     //________________________________________________________________
     Decoration::~Decoration()
     {
+        PerformanceCounters::self()->increment( PerformanceCounters::DecorationsDestroyed );
+
         g_sDecoCount--;
         if (g_sDecoCount == 0) {
-            // last deco destroyed, clean up shadow
-            g_sShadow.clear();
-        }
-
-        deleteSizeGrip();
-
-    }
-
-    //________________________________________________________________
-    float Decoration::scaleFactor() const
-    {
-
-        // probonopd: Allow using BREEZE_SCALE_FACTOR
-        float scalefactor = 1.0;
-        // qDebug() << QProcess::systemEnvironment();
-        if(getenv("BREEZE_SCALE_FACTOR")) {
-            // qDebug() << "Using BREEZE_SCALE_FACTOR as scaleFactor";
-            QString floatString = qgetenv("BREEZE_SCALE_FACTOR");
-            QTextStream floatTextStream(&floatString);
-            floatTextStream >> scalefactor;
+            // last deco destroyed, clean up shadows, title bar tiles and window properties
+            g_shadows.clear();
+            g_titleBarTiles.clear();
+            WindowInfoCache::release();
         }
-        // qDebug() << "Using scaleFactor" << scalefactor;
-        return scalefactor;
-
     }
 
     //________________________________________________________________
@@ -205,17 +244,19 @@ namespace Breeze
         if( m_opacity == value ) return;
         m_opacity = value;
         update();
-
-        if( m_sizeGrip ) m_sizeGrip->update();
     }
 
+    //________________________________________________________________
+    bool Decoration::isAnimating() const
+    { return AnimationDriver::self()->isAnimating( this ); }
+
     //________________________________________________________________
     QColor Decoration::titleBarColor() const
     {
 
         auto c = client().data();
         if( hideTitleBar() ) return c->color( ColorGroup::Inactive, ColorRole::TitleBar );
-        else if( m_animation->state() == QAbstractAnimation::Running )
+        else if( isAnimating() )
         {
             return KColorUtils::mix(
                 c->color( ColorGroup::Inactive, ColorRole::TitleBar ),
@@ -231,7 +272,7 @@ namespace Breeze
 
         auto c( client().data() );
         if( !m_internalSettings->drawTitleBarSeparator() ) return QColor();
-        if( m_animation->state() == QAbstractAnimation::Running )
+        if( isAnimating() )
         {
             QColor color( c->palette().color( QPalette::Highlight ) );
             color.setAlpha( color.alpha()*m_opacity );
@@ -245,7 +286,7 @@ namespace Breeze
     {
 
         auto c = client().data();
-        if( m_animation->state() == QAbstractAnimation::Running )
+        if( isAnimating() )
         {
             return KColorUtils::mix(
                 c->color( ColorGroup::Inactive, ColorRole::Foreground ),
@@ -260,18 +301,13 @@ namespace Breeze
     {
         auto c = client().data();
 
-        // active state change animation
-        // It is important start and end value are of the same type, hence 0.0 and not just 0
-        m_animation->setStartValue( 0.0 );
-        m_animation->setEndValue( 1.0 );
-        m_animation->setEasingCurve( QEasingCurve::InOutQuad );
-        connect(m_animation, &QVariantAnimation::valueChanged, this, [this](const QVariant &value) {
-            setOpacity(value.toReal());
-        });
-
         reconfigure();
         updateTitleBar();
         auto s = settings();
+
+        // borders are recomputed right away, since they define the window frame geometry.
+        // Title bar and buttons only depend on the final state and are recomputed once,
+        // on the next event loop iteration, however many signals were emitted in between
         connect(s.data(), &KDecoration2::DecorationSettings::borderSizeChanged, this, &Decoration::recalculateBorders);
 
         // a change in font might cause the borders to change
@@ -279,36 +315,54 @@ namespace Breeze
         connect(s.data(), &KDecoration2::DecorationSettings::spacingChanged, this, &Decoration::recalculateBorders);
 
         // buttons
-        connect(s.data(), &KDecoration2::DecorationSettings::spacingChanged, this, &Decoration::updateButtonsGeometryDelayed);
-        connect(s.data(), &KDecoration2::DecorationSettings::decorationButtonsLeftChanged, this, &Decoration::updateButtonsGeometryDelayed);
-        connect(s.data(), &KDecoration2::DecorationSettings::decorationButtonsRightChanged, this, &Decoration::updateButtonsGeometryDelayed);
+        connect(s.data(), &KDecoration2::DecorationSettings::spacingChanged, this, [this]() { scheduleLayout( ButtonsLayout ); } );
+        connect(s.data(), &KDecoration2::DecorationSettings::decorationButtonsLeftChanged, this, [this]() { scheduleLayout( ButtonsLayout ); } );
+        connect(s.data(), &KDecoration2::DecorationSettings::decorationButtonsRightChanged, this, [this]() { scheduleLayout( ButtonsLayout ); } );
 
-        // full reconfiguration
-        connect(s.data(), &KDecoration2::DecorationSettings::reconfigured, this, &Decoration::reconfigure);
+        // reconfiguration. The settings provider must come first, so that
+        // decorations see the new settings and what changed
         connect(s.data(), &KDecoration2::DecorationSettings::reconfigured, SettingsProvider::self(), &SettingsProvider::reconfigure, Qt::UniqueConnection );
-        connect(s.data(), &KDecoration2::DecorationSettings::reconfigured, this, &Decoration::updateButtonsGeometryDelayed);
+        connect(s.data(), &KDecoration2::DecorationSettings::reconfigured, this, &Decoration::updateSettings);
 
         connect(c, &KDecoration2::DecoratedClient::adjacentScreenEdgesChanged, this, &Decoration::recalculateBorders);
         connect(c, &KDecoration2::DecoratedClient::maximizedHorizontallyChanged, this, &Decoration::recalculateBorders);
         connect(c, &KDecoration2::DecoratedClient::maximizedVerticallyChanged, this, &Decoration::recalculateBorders);
         connect(c, &KDecoration2::DecoratedClient::shadedChanged, this, &Decoration::recalculateBorders);
+        connect(c, &KDecoration2::DecoratedClient::resizeableChanged, this, &Decoration::recalculateBorders);
         connect(c, &KDecoration2::DecoratedClient::captionChanged, this,
             [this]()
             {
-                // update the caption area
+                // settings depend on the caption only if some exceptions match titles
+                if( SettingsProvider::self()->hasTitleExceptions()
+                    && SettingsProvider::self()->internalSettings( this ) != m_internalSettings )
+                {
+                    reconfigure();
+                    update();
+                    return;
+                }
+
+                // drop cached caption layout and update the caption area
+                m_captionCache.textValid = false;
+                m_captionCache.boundingRectValid = false;
                 update(titleBar());
             }
         );
 
         connect(c, &KDecoration2::DecoratedClient::activeChanged, this, &Decoration::updateAnimationState);
-        connect(c, &KDecoration2::DecoratedClient::widthChanged, this, &Decoration::updateTitleBar);
-        connect(c, &KDecoration2::DecoratedClient::maximizedChanged, this, &Decoration::updateTitleBar);
+        connect(c, &KDecoration2::DecoratedClient::activeChanged, this, &Decoration::updateSizeGrip);
+
+        // width changes less than this apart are considered part of the same interactive resize
+        m_resizeTimer = new QTimer( this );
+        m_resizeTimer->setSingleShot( true );
+        m_resizeTimer->setInterval( 150 );
+        connect(m_resizeTimer, &QTimer::timeout, this, &Decoration::resizeFinished);
+
+        connect(c, &KDecoration2::DecoratedClient::widthChanged, this, &Decoration::updateResizeState);
+        connect(c, &KDecoration2::DecoratedClient::maximizedChanged, this, [this]() { scheduleLayout( TitleBarLayout|ButtonsLayout ); } );
         //connect(c, &KDecoration2::DecoratedClient::maximizedChanged, this, &Decoration::setOpaque);
 
-        connect(c, &KDecoration2::DecoratedClient::widthChanged, this, &Decoration::updateButtonsGeometry);
-        connect(c, &KDecoration2::DecoratedClient::maximizedChanged, this, &Decoration::updateButtonsGeometry);
-        connect(c, &KDecoration2::DecoratedClient::adjacentScreenEdgesChanged, this, &Decoration::updateButtonsGeometry);
-        connect(c, &KDecoration2::DecoratedClient::shadedChanged, this, &Decoration::updateButtonsGeometry);
+        connect(c, &KDecoration2::DecoratedClient::adjacentScreenEdgesChanged, this, [this]() { scheduleLayout( ButtonsLayout ); } );
+        connect(c, &KDecoration2::DecoratedClient::shadedChanged, this, [this]() { scheduleLayout( ButtonsLayout ); } );
 
         createButtons();
         createShadow();
@@ -334,8 +388,14 @@ namespace Breeze
         {
 
             auto c = client().data();
-            m_animation->setDirection( c->isActive() ? QAbstractAnimation::Forward : QAbstractAnimation::Backward );
-            if( m_animation->state() != QAbstractAnimation::Running ) m_animation->start();
+            AnimationDriver::self()->animate( this, this, c->isActive(), m_internalSettings->animationsDuration(),
+                [this]( qreal value )
+                {
+                    // the whole decoration is repainted, once per frame
+                    if( m_opacity == value ) return QRect();
+                    m_opacity = value;
+                    return rect();
+                } );
 
         } else {
 
@@ -345,11 +405,27 @@ namespace Breeze
     }
 
     //________________________________________________________________
-    void Decoration::updateSizeGripVisibility()
+    bool Decoration::hasSizeGrip() const
     {
         auto c = client().data();
-        if( m_sizeGrip )
-        { m_sizeGrip->setVisible( c->isResizeable() && !isMaximized() && !c->isShaded() ); }
+        return m_internalSettings && m_internalSettings->drawSizeGrip() && hasNoBorders()
+            && c->isResizeable() && !isMaximized() && !c->isShaded();
+    }
+
+    //________________________________________________________________
+    QRgb Decoration::sizeGripColor() const
+    {
+        if( !hasSizeGrip() ) return 0;
+
+        // not animated, the shadow is only regenerated when the active state changes
+        auto c = client().data();
+        return c->color( c->isActive() ? ColorGroup::Active : ColorGroup::Inactive, ColorRole::TitleBar ).rgba();
+    }
+
+    //________________________________________________________________
+    void Decoration::updateSizeGrip()
+    {
+        if( m_internalSettings && sizeGripColor() != m_sizeGripColor ) createShadow();
     }
 
     //________________________________________________________________
@@ -393,11 +469,12 @@ namespace Breeze
     //________________________________________________________________
     void Decoration::reconfigure()
     {
+        const Tracer::Span span( "Decoration::reconfigure", this );
 
         m_internalSettings = SettingsProvider::self()->internalSettings( this );
 
-        // animation
-        m_animation->setDuration( m_internalSettings->animationsDuration() );
+        // caption font and layout
+        m_captionCache = CaptionCache();
 
         // borders
         recalculateBorders();
@@ -405,9 +482,39 @@ namespace Breeze
         // shadow
         createShadow();
 
-        // size grip
-        if( hasNoBorders() && m_internalSettings->drawSizeGrip() ) createSizeGrip();
-        else deleteSizeGrip();
+    }
+
+    //________________________________________________________________
+    void Decoration::updateSettings()
+    {
+
+        auto provider = SettingsProvider::self();
+
+        // a different settings object, typically because exceptions changed: reconfigure everything
+        const auto internalSettings = provider->internalSettings( this );
+        if( internalSettings != m_internalSettings )
+        {
+            reconfigure();
+            scheduleLayout( ButtonsLayout );
+            update();
+            return;
+        }
+
+        // the font might also have changed in kwin settings, caption layout is cheap to redo
+        m_captionCache = CaptionCache();
+
+        const auto changes = provider->changes();
+
+        // borders, which also decide whether the size grip is shown
+        if( changes & ( SettingsProvider::BorderChange|SettingsProvider::SizeGripChange ) ) recalculateBorders();
+
+        // shadow
+        if( changes & SettingsProvider::ShadowChange ) createShadow();
+
+        // buttons
+        if( changes & SettingsProvider::ButtonChange ) scheduleLayout( ButtonsLayout );
+
+        update();
 
     }
 
@@ -428,10 +535,17 @@ namespace Breeze
             top = 22 * this->scaleFactor(); // probono: Absolute height of the title bar in pixels
         }
 
-        setBorders(QMargins(left, top, right, bottom));
+        // title bar and button positions depend on the borders
+        const QMargins borders( left, top, right, bottom );
+        if( borders != this->borders() )
+        {
+            setBorders( borders );
+            scheduleLayout( TitleBarLayout|ButtonsLayout );
+        }
 
         // extended sizes
-        const int extSize = s->largeSpacing();
+        // the size grip is drawn over the extended area, which must be large enough to grab it
+        const int extSize = hasSizeGrip() ? qMax( s->largeSpacing(), sizeGripSize() ) : s->largeSpacing();
         int extSides = 0;
         int extBottom = 0;
         if( hasNoBorders() )
@@ -446,6 +560,9 @@ namespace Breeze
         }
 
         setResizeOnlyBorders(QMargins(extSides, 0, extSides, extBottom));
+
+        // the size grip is part of the shadow
+        updateSizeGrip();
     }
 
     //________________________________________________________________
@@ -457,12 +574,61 @@ namespace Breeze
     }
 
     //________________________________________________________________
-    void Decoration::updateButtonsGeometryDelayed()
-    { QTimer::singleShot( 0, this, &Decoration::updateButtonsGeometry ); }
+    void Decoration::scheduleLayout( LayoutParts parts )
+    {
+        if( !m_dirtyLayout ) QTimer::singleShot( 0, this, &Decoration::updateLayout );
+        m_dirtyLayout |= parts;
+    }
+
+    //________________________________________________________________
+    void Decoration::updateLayout()
+    {
+        const LayoutParts parts( m_dirtyLayout );
+        m_dirtyLayout = LayoutParts();
+
+        if( parts & TitleBarLayout ) updateTitleBar();
+        if( !( m_leftButtons && m_rightButtons ) ) return;
+
+        if( parts & ButtonsLayout ) updateButtonsGeometry();
+        else if( parts & RightButtonsPosition )
+        {
+
+            // nothing else depends on the width. No explicit repaint is needed either,
+            // since the whole decoration is repainted when the window is resized
+            const int delta = size().width() - m_layoutWidth;
+            if( delta != 0 && !m_rightButtons->buttons().isEmpty() )
+            { m_rightButtons->setPos( m_rightButtons->pos() + QPointF( delta, 0 ) ); }
+
+            m_layoutWidth = size().width();
+
+        }
+    }
+
+    //________________________________________________________________
+    void Decoration::updateResizeState()
+    {
+        if( m_resizeTimer->isActive() ) m_resizing = true;
+        m_resizeTimer->start();
+
+        if( m_resizing ) scheduleLayout( TitleBarLayout|RightButtonsPosition );
+        else scheduleLayout( TitleBarLayout|ButtonsLayout );
+    }
+
+    //________________________________________________________________
+    void Decoration::resizeFinished()
+    {
+        if( !m_resizing ) return;
+        m_resizing = false;
+
+        // full layout, which also repaints and elides the caption to its final width
+        scheduleLayout( ButtonsLayout );
+    }
 
     //________________________________________________________________
     void Decoration::updateButtonsGeometry()
     {
+        const Tracer::Span span( "Decoration::updateButtonsGeometry", this );
+
         const auto s = settings();
 
         // adjust button position
@@ -523,6 +689,7 @@ namespace Breeze
 
         }
 
+        m_layoutWidth = size().width();
         update();
 
     }
@@ -530,14 +697,32 @@ namespace Breeze
     //________________________________________________________________
     void Decoration::paint(QPainter *painter, const QRect &repaintRegion)
     {
-        // TODO: optimize based on repaintRegion
+        const PerformanceCounters::ScopedTiming timing( PerformanceCounters::Paint );
+        const Tracer::Span span( "Decoration::paint", this );
+
         auto c = client().data();
         auto s = settings();
 
+        // the shadow follows the device pixel ratio of the output the window is painted on
+        const qreal devicePixelRatio = painter->device()->devicePixelRatioF();
+        if( !qFuzzyCompare( devicePixelRatio, m_devicePixelRatio ) )
+        {
+            m_devicePixelRatio = devicePixelRatio;
+            QTimer::singleShot( 0, this, &Decoration::createShadow );
+        }
+
+        // only the damaged area needs to be repainted
+        const QRect paintRect( rect() & repaintRegion );
+        if( paintRect.isEmpty() ) return;
+
+        painter->save();
+        painter->setClipRect( paintRect, Qt::IntersectClip );
+
         // paint background
-        if( !c->isShaded() )
+        const QRect frameRect = hideTitleBar() ? rect() : QRect( 0, borderTop(), size().width(), size().height() - borderTop() );
+        if( !c->isShaded() && frameRect.intersects( paintRect ) )
         {
-            painter->fillRect(rect(), Qt::transparent);
+            painter->fillRect(paintRect, Qt::transparent);
             painter->save();
             painter->setRenderHint(QPainter::Antialiasing);
             painter->setPen(Qt::NoPen);
@@ -547,7 +732,7 @@ namespace Breeze
             painter->setBrush(winCol);
 
             // clip away the top part
-            if( !hideTitleBar() ) painter->setClipRect(0, borderTop(), size().width(), size().height() - borderTop(), Qt::IntersectClip);
+            if( !hideTitleBar() ) painter->setClipRect(frameRect, Qt::IntersectClip);
 
             if( s->isAlphaChannelSupported() ) painter->drawRoundedRect(rect(), Metrics::Frame_FrameRadius, Metrics::Frame_FrameRadius);
             else painter->drawRect( rect() );
@@ -555,9 +740,10 @@ namespace Breeze
             painter->restore();
         }
 
-        if( !hideTitleBar() ) paintTitleBar(painter, repaintRegion);
+        if( !hideTitleBar() ) paintTitleBar(painter, paintRect);
 
-        if( hasBorders() && !s->isAlphaChannelSupported() )
+        // the outline is skipped when the damaged area does not reach the window edges
+        if( hasBorders() && !s->isAlphaChannelSupported() && !rect().adjusted( 1, 1, -1, -1 ).contains( paintRect ) )
         {
             painter->save();
             painter->setRenderHint(QPainter::Antialiasing, false);
@@ -570,16 +756,141 @@ namespace Breeze
             painter->restore();
         }
 
+        painter->restore();
+
     }
 
     //________________________________________________________________
     void Decoration::paintTitleBar(QPainter *painter, const QRect &repaintRegion)
     {
+        const Tracer::Span span( "Decoration::paintTitleBar", this );
+
         const auto c = client().data();
         const QRect titleRect(QPoint(0, 0), QSize(size().width(), borderTop()));
 
         if ( !titleRect.intersects(repaintRegion) ) return;
 
+        paintTitleBarBackground(painter, titleRect, repaintRegion);
+
+        // this would be ugly
+        /*const QColor outlineColor( this->outlineColor() );
+        if( !c->isShaded() && outlineColor.isValid() )
+        {
+            // outline
+            painter->setRenderHint( QPainter::Antialiasing, false );
+            painter->setBrush( Qt::NoBrush );
+            painter->setPen( outlineColor );
+            painter->drawLine( titleRect.bottomLeft(), titleRect.bottomRight() );
+        }*/
+
+        // draw caption
+        const auto cR = captionRect();
+        if( cR.first.intersects( repaintRegion ) )
+        {
+            painter->setFont( captionFont() );
+            painter->setPen( fontColor() );
+            const QStaticText &caption( captionText( painter->device(), cR.first.width() ) );
+
+            // the caption is not elided again during interactive resize, and might not fit
+            painter->save();
+            if( m_resizing ) painter->setClipRect( cR.first, Qt::IntersectClip );
+
+            // align the prepared text inside the caption rect
+            const QSizeF textSize( caption.size() );
+            qreal x = cR.first.left();
+            if( cR.second & Qt::AlignRight ) x = cR.first.right() + 1 - textSize.width();
+            else if( cR.second & Qt::AlignHCenter ) x = cR.first.left() + ( cR.first.width() - textSize.width() )/2;
+            const qreal y = cR.first.top() + ( cR.first.height() - textSize.height() )/2;
+
+            painter->drawStaticText( QPoint( qRound( x ), qRound( y ) ), caption );
+            painter->restore();
+        }
+
+        // draw all buttons
+        m_leftButtons->paint(painter, repaintRegion);
+        m_rightButtons->paint(painter, repaintRegion);
+    }
+
+    //________________________________________________________________
+    void Decoration::paintTitleBarBackground(QPainter *painter, const QRect &titleRect, const QRect &repaintRegion) const
+    {
+
+        /*
+        the title bar background only varies vertically, except for the rounded corners.
+        It is therefore rendered once into a small tile made of a left cap, a single pixel wide middle
+        and a right cap, which is then stretched over the title bar width
+        */
+        const qreal radius = Metrics::Frame_FrameRadius*this->scaleFactor();
+        const int capWidth = qCeil( radius ) + 1;
+        const int tileWidth = 2*capWidth + 1;
+
+        // fallback to direct rendering for title bars too narrow for the tile to be stretched
+        if( titleRect.width() <= tileWidth )
+        {
+            renderTitleBarBackground(painter, titleRect);
+            return;
+        }
+
+        QColor titleBarColor( this->titleBarColor() );
+        titleBarColor.setAlpha(titleBarAlpha());
+
+        const qreal dpr = painter->device()->devicePixelRatioF();
+
+        TitleBarTileKey key;
+        key.color = titleBarColor.rgba();
+        key.gradientIntensity = ( m_internalSettings->drawBackgroundGradient() && !flatTitleBar() ) ? m_internalSettings->backgroundGradientIntensity():-1;
+        key.height = titleRect.height();
+        key.scale = qRound( this->scaleFactor()*100 );
+        key.devicePixelRatio = qRound( dpr*100 );
+        key.flags =
+            ( isMaximized() ? TitleBarTileKey::Maximized:0 ) |
+            ( settings()->isAlphaChannelSupported() ? TitleBarTileKey::AlphaChannel:0 ) |
+            ( client().data()->isShaded() ? TitleBarTileKey::Shaded:0 ) |
+            ( isLeftEdge() ? TitleBarTileKey::LeftEdge:0 ) |
+            ( isTopEdge() ? TitleBarTileKey::TopEdge:0 ) |
+            ( isRightEdge() ? TitleBarTileKey::RightEdge:0 ) |
+            ( painter->testRenderHint( QPainter::Antialiasing ) ? TitleBarTileKey::Antialiasing:0 );
+
+        QImage *tile = g_titleBarTiles.object( key );
+        PerformanceCounters::self()->increment( tile ? PerformanceCounters::TitleBarTileHits:PerformanceCounters::TitleBarTileMisses );
+        if( !tile )
+        {
+            tile = new QImage( QSize( tileWidth, titleRect.height() )*dpr, QImage::Format_ARGB32_Premultiplied );
+            tile->setDevicePixelRatio( dpr );
+            tile->fill( Qt::transparent );
+
+            QPainter tilePainter( tile );
+            tilePainter.setRenderHints( painter->renderHints() );
+            renderTitleBarBackground( &tilePainter, QRect( 0, 0, tileWidth, titleRect.height() ) );
+            tilePainter.end();
+
+            g_titleBarTiles.insert( key, tile );
+        }
+
+        // left cap, stretched middle and right cap, restricted to the damaged area
+        const qreal tileHeight = titleRect.height()*dpr;
+        const QRect leftCapRect( titleRect.left(), titleRect.top(), capWidth, titleRect.height() );
+        if( leftCapRect.intersects( repaintRegion ) )
+        { painter->drawImage( leftCapRect, *tile, QRectF( 0, 0, capWidth*dpr, tileHeight ) ); }
+
+        // the middle part is uniform horizontally, so that it can be cropped freely
+        const QRect middleRect = QRect( titleRect.left() + capWidth, titleRect.top(), titleRect.width() - 2*capWidth, titleRect.height() ) & repaintRegion;
+        if( !middleRect.isEmpty() )
+        {
+            painter->drawImage(
+                QRect( middleRect.left(), titleRect.top(), middleRect.width(), titleRect.height() ),
+                *tile, QRectF( capWidth*dpr, 0, dpr, tileHeight ) );
+        }
+
+        const QRect rightCapRect( titleRect.right() + 1 - capWidth, titleRect.top(), capWidth, titleRect.height() );
+        if( rightCapRect.intersects( repaintRegion ) )
+        { painter->drawImage( rightCapRect, *tile, QRectF( ( capWidth + 1 )*dpr, 0, capWidth*dpr, tileHeight ) ); }
+
+    }
+
+    //________________________________________________________________
+    void Decoration::renderTitleBarBackground(QPainter *painter, const QRect &titleRect) const
+    {
         painter->save();
         painter->setPen(Qt::NoPen);
 
@@ -615,6 +926,7 @@ namespace Breeze
 
         }
 
+        auto c = client().data();
         auto s = settings();
         if( isMaximized() || !s->isAlphaChannelSupported() )
         {
@@ -639,33 +951,8 @@ namespace Breeze
 
         }
 
-        // this would be ugly
-        /*const QColor outlineColor( this->outlineColor() );
-        if( !c->isShaded() && outlineColor.isValid() )
-        {
-            // outline
-            painter->setRenderHint( QPainter::Antialiasing, false );
-            painter->setBrush( Qt::NoBrush );
-            painter->setPen( outlineColor );
-            painter->drawLine( titleRect.bottomLeft(), titleRect.bottomRight() );
-        }*/
-
         painter->restore();
 
-        // draw caption
-        QFont f; f.fromString(m_internalSettings->titleBarFont());
-        f.setPointSize(f.pointSize()*this->scaleFactor());
-        // KDE needs this FIXME: Why?
-        QFontDatabase fd; f.setStyleName(fd.styleString(f));
-        painter->setFont(f);
-        painter->setPen( fontColor() );
-        const auto cR = captionRect();
-        const QString caption = painter->fontMetrics().elidedText(c->caption(), Qt::ElideMiddle, cR.first.width());
-        painter->drawText(cR.first, cR.second | Qt::TextSingleLine, caption);
-
-        // draw all buttons
-        m_leftButtons->paint(painter, repaintRegion);
-        m_rightButtons->paint(painter, repaintRegion);
     }
 
     //________________________________________________________________
@@ -725,9 +1012,15 @@ namespace Breeze
 
                     // full caption rect
                     const QRect fullRect = QRect( 0, yOffset, size().width(), captionHeight() );
-                    QFont f; f.fromString(m_internalSettings->titleBarFont());
-                    QFontMetrics fm(f);
-                    QRect boundingRect( fm.boundingRect( c->caption()) );
+                    if( !m_captionCache.boundingRectValid )
+                    {
+                        QFont f; f.fromString(m_internalSettings->titleBarFont());
+                        QFontMetrics fm(f);
+                        m_captionCache.boundingRect = fm.boundingRect( c->caption() );
+                        m_captionCache.boundingRectValid = true;
+                    }
+
+                    QRect boundingRect( m_captionCache.boundingRect );
 
                     // text bounding rect
                     boundingRect.setTop( yOffset );
@@ -746,57 +1039,111 @@ namespace Breeze
 
     }
 
+    //________________________________________________________________
+    const QFont &Decoration::captionFont() const
+    {
+        if( !m_captionCache.fontValid )
+        {
+            QFont f; f.fromString(m_internalSettings->titleBarFont());
+            f.setPointSize(f.pointSize()*this->scaleFactor());
+            // KDE needs this FIXME: Why?
+            QFontDatabase fd; f.setStyleName(fd.styleString(f));
+
+            m_captionCache.font = f;
+            m_captionCache.fontValid = true;
+        }
+
+        return m_captionCache.font;
+    }
+
+    //________________________________________________________________
+    const QStaticText &Decoration::captionText( QPaintDevice *device, int width ) const
+    {
+        // the caption is elided once the resize is finished
+        const bool widthChanged = m_captionCache.width != width && !m_resizing;
+        if( !m_captionCache.textValid || widthChanged )
+        {
+            const QFontMetrics metrics( captionFont(), device );
+            m_captionCache.text.setTextFormat( Qt::PlainText );
+            m_captionCache.text.setText( metrics.elidedText( client().data()->caption(), Qt::ElideMiddle, width ) );
+            m_captionCache.text.prepare( QTransform(), captionFont() );
+            m_captionCache.width = width;
+            m_captionCache.textValid = true;
+        }
+
+        return m_captionCache.text;
+    }
+
     //________________________________________________________________
     void Decoration::createShadow()
     {
-        if (!g_sShadow
-                ||g_shadowSizeEnum != m_internalSettings->shadowSize()
-                || g_shadowStrength != m_internalSettings->shadowStrength()
-                || g_shadowColor != m_internalSettings->shadowColor())
+        const Tracer::Span span( "Decoration::createShadow", this );
+
+        ShadowKey key;
+        key.size = m_internalSettings->shadowSize();
+        key.strength = m_internalSettings->shadowStrength();
+        key.color = m_internalSettings->shadowColor().rgba();
+        key.scale = qRound( this->scaleFactor()*100 );
+        // shadows are rendered at a device pixel ratio of 1 for now, but cached per ratio
+        // so that they can follow the output once the compositor scales shadow textures
+        key.devicePixelRatio = qRound( m_devicePixelRatio*100 );
+        key.sizeGripColor = sizeGripColor();
+        m_sizeGripColor = key.sizeGripColor;
+
+        const auto iter = g_shadows.constFind( key );
+        if( iter != g_shadows.constEnd() )
         {
-            g_shadowSizeEnum = m_internalSettings->shadowSize();
-            g_shadowStrength = m_internalSettings->shadowStrength();
-            g_shadowColor = m_internalSettings->shadowColor();
-
-            const CompositeShadowParams params = lookupShadowParams(g_shadowSizeEnum);
-            if (params.isNone()) {
-                g_sShadow.clear();
-                setShadow(g_sShadow);
-                return;
-            }
+            PerformanceCounters::self()->increment( PerformanceCounters::ShadowCacheHits );
+            setShadow( iter.value() );
+            return;
+        }
+
+        const PerformanceCounters::ScopedTiming timing( PerformanceCounters::ShadowRendering );
 
+        QSharedPointer<KDecoration2::DecorationShadow> decorationShadow;
+        QImage shadowTexture;
+        QMargins padding;
+
+        const CompositeShadowParams params = lookupShadowParams(key.size);
+        if (!params.isNone()) {
             auto withOpacity = [](const QColor &color, qreal opacity) -> QColor {
                 QColor c(color);
                 c.setAlphaF(opacity);
                 return c;
             };
 
+            const QColor shadowColor = QColor::fromRgba(key.color);
+
             const QSize boxSize = BoxShadowRenderer::calculateMinimumBoxSize(params.shadow1.radius*this->scaleFactor())
                 .expandedTo(BoxShadowRenderer::calculateMinimumBoxSize(params.shadow2.radius*this->scaleFactor()));
 
             BoxShadowRenderer shadowRenderer;
             shadowRenderer.setBorderRadius((Metrics::Frame_FrameRadius + 0.5)*this->scaleFactor());
             shadowRenderer.setBoxSize(boxSize);
-            shadowRenderer.setDevicePixelRatio(1.0); // TODO: Create HiDPI shadows?
 
-            const qreal strength = static_cast<qreal>(g_shadowStrength) / 255.0;
+            const qreal strength = static_cast<qreal>(key.strength) / 255.0;
             shadowRenderer.addShadow(params.shadow1.offset, params.shadow1.radius*this->scaleFactor(),
-                withOpacity(g_shadowColor, params.shadow1.opacity * strength));
+                withOpacity(shadowColor, params.shadow1.opacity * strength));
             shadowRenderer.addShadow(params.shadow2.offset, params.shadow2.radius*this->scaleFactor(),
-                withOpacity(g_shadowColor, params.shadow2.opacity * strength));
+                withOpacity(shadowColor, params.shadow2.opacity * strength));
 
-            QImage shadowTexture = shadowRenderer.render();
+            {
+                const Tracer::Span renderSpan( "BoxShadowRenderer::render", this );
+                shadowTexture = shadowRenderer.render();
+            }
 
             QPainter painter(&shadowTexture);
             painter.setRenderHint(QPainter::Antialiasing);
 
-            const QRect outerRect = shadowTexture.rect();
+            // the compositor treats the texture size as logical, so the shadow is rendered at a device
+            // pixel ratio of 1, whatever the ratio it is cached for
+            const QRect outerRect(QPoint(0, 0), shadowTexture.size());
 
             QRect boxRect(QPoint(0, 0), boxSize);
             boxRect.moveCenter(outerRect.center());
 
             // Mask out inner rect.
-            const QMargins padding = QMargins(
+            padding = QMargins(
                 boxRect.left() - outerRect.left() - Metrics::Shadow_Overlap - params.offset.x(),
                 boxRect.top() - outerRect.top() - Metrics::Shadow_Overlap - params.offset.y(),
                 outerRect.right() - boxRect.right() - Metrics::Shadow_Overlap + params.offset.x(),
@@ -812,7 +1159,7 @@ namespace Breeze
                 (Metrics::Frame_FrameRadius + 0.5) * this->scaleFactor());
 
             // Draw outline.
-            painter.setPen(withOpacity(g_shadowColor, 0.2 * strength));
+            painter.setPen(withOpacity(shadowColor, 0.2 * strength));
             painter.setBrush(Qt::NoBrush);
             painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
             painter.drawRoundedRect(
@@ -821,49 +1168,22 @@ namespace Breeze
                 (Metrics::Frame_FrameRadius - 0.5) * this->scaleFactor());
 
             painter.end();
-
-            g_sShadow = QSharedPointer<KDecoration2::DecorationShadow>::create();
-            g_sShadow->setPadding(padding);
-            g_sShadow->setInnerShadowRect(QRect(outerRect.center(), QSize(1, 1)));
-            g_sShadow->setShadow(shadowTexture);
         }
 
-        setShadow(g_sShadow);
-    }
-
-    //_________________________________________________________________
-    void Decoration::createSizeGrip()
-    {
-
-        // do nothing if size grip already exist
-        if( m_sizeGrip ) return;
-
-        #if BREEZE_HAVE_X11
-        if( !QX11Info::isPlatformX11() ) return;
+        // size grip, over the area the window manager resizes the window from
+        if( key.sizeGripColor ) drawSizeGrip(shadowTexture, padding, sizeGripSize(), QColor::fromRgba(key.sizeGripColor));
 
-        // access client
-        auto c = client().data();
-        if( !c ) return;
-
-        if( c->windowId() != 0 )
-        {
-            m_sizeGrip = new SizeGrip( this );
-            connect( c, &KDecoration2::DecoratedClient::maximizedChanged, this, &Decoration::updateSizeGripVisibility );
-            connect( c, &KDecoration2::DecoratedClient::shadedChanged, this, &Decoration::updateSizeGripVisibility );
-            connect( c, &KDecoration2::DecoratedClient::resizeableChanged, this, &Decoration::updateSizeGripVisibility );
+        if (!shadowTexture.isNull()) {
+            decorationShadow = QSharedPointer<KDecoration2::DecorationShadow>::create();
+            decorationShadow->setPadding(padding);
+            decorationShadow->setInnerShadowRect(QRect(shadowTexture.rect().center(), QSize(1, 1)));
+            decorationShadow->setShadow(shadowTexture);
         }
-        #endif
 
-    }
+        if( g_shadows.size() >= g_maxShadowCount ) g_shadows.clear();
+        g_shadows.insert( key, decorationShadow );
 
-    //_________________________________________________________________
-    void Decoration::deleteSizeGrip()
-    {
-        if( m_sizeGrip )
-        {
-            m_sizeGrip->deleteLater();
-            m_sizeGrip = nullptr;
-        }
+        setShadow( decorationShadow );
     }
 
 } // namespace
@@ -23,17 +23,19 @@
  */
 
 #include "breeze.h"
+#include "breezescalefactor.h"
 #include "breezesettings.h"
 
 #include <KDecoration2/Decoration>
 #include <KDecoration2/DecoratedClient>
 #include <KDecoration2/DecorationSettings>
 
+#include <QFont>
 #include <QPalette>
+#include <QStaticText>
+#include <QTimer>
 #include <QVariant>
 
-class QVariantAnimation;
-
 namespace KDecoration2
 {
     class DecorationButton;
@@ -42,7 +44,6 @@ namespace KDecoration2
 
 namespace Breeze
 {
-    class SizeGrip;
     class Decoration : public KDecoration2::Decoration
     {
         Q_OBJECT
@@ -59,7 +60,8 @@ namespace Breeze
         void paint(QPainter *painter, const QRect &repaintRegion) override;
 
         //* probonopd: Factor for scaling all rendered UI elements
-        float scaleFactor() const;
+        float scaleFactor() const
+        { return ScaleFactor::value(); }
 
         //* internal settings
         InternalSettingsPtr internalSettings() const
@@ -71,6 +73,18 @@ namespace Breeze
         //* button height
         int buttonHeight() const;
 
+        //* parts of the layout that need to be recomputed
+        enum LayoutPart
+        {
+            TitleBarLayout = 1<<0,
+            ButtonsLayout = 1<<1,
+
+            //* only move the right buttons along with the right edge, during interactive resize
+            RightButtonsPosition = 1<<2
+        };
+
+        Q_DECLARE_FLAGS( LayoutParts, LayoutPart )
+
         //*@name active state change animation
         //@{
         void setOpacity( qreal );
@@ -106,20 +120,55 @@ namespace Breeze
 
         private Q_SLOTS:
         void reconfigure();
+
+        //* apply the parts of the settings that changed on reconfiguration
+        void updateSettings();
         void recalculateBorders();
         void updateButtonsGeometry();
-        void updateButtonsGeometryDelayed();
         void updateTitleBar();
+
+        //* recompute the dirty parts of the layout
+        void updateLayout();
+
+        //*@name interactive resize
+        //@{
+
+        //* track width changes, and enter resize mode when they follow each other closely
+        void updateResizeState();
+
+        //* leave resize mode, once the width has settled
+        void resizeFinished();
+
+        //@}
+
         void updateAnimationState();
-        void updateSizeGripVisibility();
+
+        //* regenerate the shadow if the size grip changed
+        void updateSizeGrip();
 
         private:
 
         //* return the rect in which caption will be drawn
         QPair<QRect,Qt::Alignment> captionRect() const;
 
+        //* resolved title bar font
+        const QFont &captionFont() const;
+
+        //* caption, elided to given width and laid out for drawing
+        const QStaticText &captionText( QPaintDevice*, int width ) const;
+
+        //* mark given parts of the layout dirty, and schedule their update for the next event loop iteration
+        void scheduleLayout( LayoutParts );
+
         void createButtons();
         void paintTitleBar(QPainter *painter, const QRect &repaintRegion);
+
+        //* paint title bar background, using cached tiles whenever possible
+        void paintTitleBarBackground(QPainter *painter, const QRect &titleRect, const QRect &repaintRegion) const;
+
+        //* render title bar background into given rect
+        void renderTitleBarBackground(QPainter *painter, const QRect &titleRect) const;
+
         void createShadow();
 
         //*@name border size
@@ -139,27 +188,78 @@ namespace Breeze
 
         //*@name size grip
         //@{
-        void createSizeGrip();
-        void deleteSizeGrip();
-        SizeGrip* sizeGrip() const
-        { return m_sizeGrip; }
+
+        //* true if a size grip is drawn. It requires a window with no borders, that can be resized
+        /**
+        the decoration cannot paint over the client, and windows without borders have no room for it.
+        The grip is drawn into the shadow instead, just outside the bottom right corner of the window,
+        where the extended borders let the window manager resize the window
+        */
+        bool hasSizeGrip() const;
+
+        //* size grip color, or 0 if there is no size grip
+        QRgb sizeGripColor() const;
+
+        //* size grip size
+        int sizeGripSize() const
+        { return SizeGripSize*this->scaleFactor(); }
+
+        //* unscaled size grip size
+        enum { SizeGripSize = 14 };
+
         //@}
 
         InternalSettingsPtr m_internalSettings;
         KDecoration2::DecorationButtonGroup *m_leftButtons = nullptr;
         KDecoration2::DecorationButtonGroup *m_rightButtons = nullptr;
 
-        //* size grip widget
-        SizeGrip *m_sizeGrip = nullptr;
+        //* layout parts to be recomputed
+        LayoutParts m_dirtyLayout;
+
+        //* decoration width the buttons were last positioned for
+        int m_layoutWidth = -1;
+
+        //* true while the window is being resized interactively
+        bool m_resizing = false;
 
-        //* active state change animation
-        QVariantAnimation *m_animation;
+        //* restarted on every width change, detects the end of an interactive resize
+        QTimer *m_resizeTimer = nullptr;
+
+        //* true if the active state change animation is running
+        bool isAnimating() const;
 
         //* active state change opacity
         qreal m_opacity = 0;
 
+        //* device pixel ratio the shadow is rendered for
+        qreal m_devicePixelRatio = 1.0;
+
+        //* size grip color the current shadow was created with
+        QRgb m_sizeGripColor = 0;
+
+        //* cached caption layout, invalidated on caption change and reconfiguration
+        struct CaptionCache
+        {
+            //* resolved title bar font
+            bool fontValid = false;
+            QFont font;
+
+            //* caption bounding rect, used for full width centering
+            bool boundingRectValid = false;
+            QRect boundingRect;
+
+            //* elided and prepared caption, for a given width
+            bool textValid = false;
+            int width = -1;
+            QStaticText text;
+        };
+
+        mutable CaptionCache m_captionCache;
+
     };
 
+    Q_DECLARE_OPERATORS_FOR_FLAGS( Decoration::LayoutParts )
+
     bool Decoration::hasBorders() const
     {
         if( m_internalSettings && m_internalSettings->mask() & BorderSize ) return m_internalSettings->borderSize() > InternalSettings::BorderNoSides;
@@ -31,7 +31,7 @@ namespace Breeze
 {
 
     //______________________________________________________________
-    void ExceptionList::readConfig( KSharedConfig::Ptr config )
+    void ExceptionList::readConfig( KSharedConfig::Ptr config, const InternalSettings* defaults )
     {
 
         _exceptions.clear();
@@ -40,29 +40,25 @@ namespace Breeze
         for( int index = 0; config->hasGroup( groupName = exceptionGroupName( index ) ); ++index )
         {
 
-            // create exception
-            InternalSettings exception;
+            // create exception. Only the exception keys are read, the remaining
+            // settings are taken from the defaults when the exception is applied
+            InternalSettingsPtr configuration( new InternalSettings() );
 
-            // reset group
-            readConfig( &exception, config.data(), groupName );
+            // seed from defaults, without reading the configuration again
+            if( defaults )
+            {
+                foreach( KConfigSkeletonItem* item, defaults->items() )
+                {
+                    if( KConfigSkeletonItem* copy = configuration->findItem( item->name() ) )
+                    { copy->setProperty( item->property() ); }
+                }
+            }
 
-            // create new configuration
-            InternalSettingsPtr configuration( new InternalSettings() );
-            configuration.data()->load();
-
-            // apply changes from exception
-            configuration->setEnabled( exception.enabled() );
-            configuration->setExceptionType( exception.exceptionType() );
-            configuration->setExceptionPattern( exception.exceptionPattern() );
-            configuration->setMask( exception.mask() );
-
-            // propagate all features found in mask to the output configuration
-            if( exception.mask() & BorderSize ) configuration->setBorderSize( exception.borderSize() );
-            configuration->setHideTitleBar( exception.hideTitleBar() );
-            configuration->setOpaqueTitleBar( exception.opaqueTitleBar() );
-            configuration->setOpacityOverride( exception.opacityOverride() );
-            configuration->setFlatTitleBar( exception.flatTitleBar() );
-            configuration->setIsDialog( exception.isDialog() );
+            readConfig( configuration.data(), config.data(), groupName );
+
+            // border size is only overridden when set in mask
+            if( defaults && !( configuration->mask() & BorderSize ) )
+            { configuration->setBorderSize( defaults->borderSize() ); }
 
             // append to exceptions
             _exceptions.append( configuration );
@@ -92,6 +88,13 @@ namespace Breeze
 
     }
 
+    //_______________________________________________________________________
+    const QStringList& ExceptionList::exceptionKeys()
+    {
+        static const QStringList keys = { "Enabled", "ExceptionPattern", "ExceptionType", "HideTitleBar", "IsDialog", "OpaqueTitleBar", "OpacityOverride", "FlatTitleBar", "Mask", "BorderSize"};
+        return keys;
+    }
+
     //_______________________________________________________________________
     QString ExceptionList::exceptionGroupName( int index )
     { return QString( "Windeco Exception %1" ).arg( index ); }
@@ -100,11 +103,8 @@ namespace Breeze
     void ExceptionList::writeConfig( KCoreConfigSkeleton* skeleton, KConfig* config, const QString& groupName )
     {
 
-        // list of items to be written
-        QStringList keys = { "Enabled", "ExceptionPattern", "ExceptionType", "HideTitleBar", "IsDialog", "OpaqueTitleBar", "OpacityOverride", "FlatTitleBar", "Mask", "BorderSize"};
-
         // write all items
-        foreach( auto key, keys )
+        foreach( auto key, exceptionKeys() )
         {
             KConfigSkeletonItem* item( skeleton->findItem( key ) );
             if( !item ) continue;
@@ -121,8 +121,12 @@ namespace Breeze
     void ExceptionList::readConfig( KCoreConfigSkeleton* skeleton, KConfig* config, const QString& groupName )
     {
 
-        foreach( KConfigSkeletonItem* item, skeleton->items() )
+        // read all items
+        foreach( auto key, exceptionKeys() )
         {
+            KConfigSkeletonItem* item( skeleton->findItem( key ) );
+            if( !item ) continue;
+
             if( !groupName.isEmpty() ) item->setGroup( groupName );
             item->readConfig( config );
         }
@@ -51,11 +51,18 @@ namespace Breeze
         { return _exceptions; }
 
         //! read from KConfig
-        void readConfig( KSharedConfig::Ptr );
+        /*!
+        only the exception keys are read. When editing exceptions, pass the default settings,
+        so that the values the exception does not override show the defaults
+        */
+        void readConfig( KSharedConfig::Ptr, const InternalSettings* defaults = nullptr );
 
         //! write to kconfig
         void writeConfig( KSharedConfig::Ptr );
 
+        //! keys of the settings stored in an exception
+        static const QStringList& exceptionKeys();
+
         protected:
 
         //! generate exception group name for given exception index
@@ -0,0 +1,182 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "breezeperformancecounters.h"
+
+#include <QDBusConnection>
+#include <QVariantList>
+
+namespace
+{
+
+    //* counter names, as exported
+    const char *const s_counterNames[] =
+    {
+        "decorationsCreated",
+        "decorationsDestroyed",
+        "shadowCacheHits",
+        "titleBarTileHits",
+        "titleBarTileMisses",
+        "buttonIconHits",
+        "buttonIconMisses",
+        "resolvedSettingsHits",
+        "resolvedSettingsMisses",
+        "animationTicks"
+    };
+
+    static_assert( sizeof( s_counterNames )/sizeof( s_counterNames[0] ) == Breeze::PerformanceCounters::CounterCount, "missing counter name" );
+
+    //* timing names, as exported
+    const char *const s_timingNames[] =
+    {
+        "paint",
+        "shadowRendering",
+        "exceptionMatching"
+    };
+
+    static_assert( sizeof( s_timingNames )/sizeof( s_timingNames[0] ) == Breeze::PerformanceCounters::TimingCount, "missing timing name" );
+
+    //* hits over lookups, or zero when nothing was looked up
+    qreal hitRate( quint64 hits, quint64 misses )
+    { return ( hits + misses ) ? qreal( hits )/( hits + misses ) : 0; }
+
+}
+
+namespace Breeze
+{
+
+    PerformanceCounters *PerformanceCounters::s_self = nullptr;
+
+    //__________________________________________________________________
+    PerformanceCounters *PerformanceCounters::self()
+    {
+        if( !s_self )
+        {
+            s_self = new PerformanceCounters();
+
+            // may fail when KWin runs without a session bus, counters are still accumulated
+            QDBusConnection::sessionBus().registerObject( QStringLiteral( "/BreezeDecoration" ), s_self, QDBusConnection::ExportScriptableSlots );
+        }
+
+        return s_self;
+    }
+
+    //__________________________________________________________________
+    PerformanceCounters::PerformanceCounters()
+    {
+        for( std::atomic<quint64> &counter : m_counters ) counter.store( 0, std::memory_order_relaxed );
+        reset();
+    }
+
+    //__________________________________________________________________
+    void PerformanceCounters::addTiming( Timing timing, qint64 nanoseconds )
+    {
+        TimingData &data( m_timings[timing] );
+        const quint64 duration( qMax<qint64>( 0, nanoseconds ) );
+
+        data.count.fetch_add( 1, std::memory_order_relaxed );
+        data.totalTime.fetch_add( duration, std::memory_order_relaxed );
+
+        quint64 maxTime( data.maxTime.load( std::memory_order_relaxed ) );
+        while( duration > maxTime && !data.maxTime.compare_exchange_weak( maxTime, duration, std::memory_order_relaxed ) )
+        {}
+
+        // log2 of the duration in microseconds
+        int bucket = 0;
+        for( quint64 microseconds = duration/1000; microseconds > 1 && bucket < HistogramSize - 1; microseconds >>= 1 )
+        { ++bucket; }
+
+        data.histogram[bucket].fetch_add( 1, std::memory_order_relaxed );
+    }
+
+    //__________________________________________________________________
+    QVariantMap PerformanceCounters::counters() const
+    {
+        quint64 values[CounterCount];
+        QVariantMap out;
+        for( int index = 0; index < CounterCount; ++index )
+        {
+            values[index] = m_counters[index].load( std::memory_order_relaxed );
+            out.insert( QString::fromLatin1( s_counterNames[index] ), values[index] );
+        }
+
+        // shadow cache misses are the shadow renderings
+        const quint64 shadowRenderings( m_timings[ShadowRendering].count.load( std::memory_order_relaxed ) );
+        out.insert( QStringLiteral( "shadowCacheHitRate" ), hitRate( values[ShadowCacheHits], shadowRenderings ) );
+        out.insert( QStringLiteral( "titleBarTileHitRate" ), hitRate( values[TitleBarTileHits], values[TitleBarTileMisses] ) );
+        out.insert( QStringLiteral( "buttonIconHitRate" ), hitRate( values[ButtonIconHits], values[ButtonIconMisses] ) );
+        out.insert( QStringLiteral( "resolvedSettingsHitRate" ), hitRate( values[ResolvedSettingsHits], values[ResolvedSettingsMisses] ) );
+
+        out.insert( QStringLiteral( "liveDecorations" ), values[DecorationsCreated] - values[DecorationsDestroyed] );
+
+        const qint64 elapsed( m_timer.elapsed() );
+        out.insert( QStringLiteral( "animationTicksPerSecond" ), elapsed > 0 ? values[AnimationTicks]*1000.0/elapsed : 0 );
+        out.insert( QStringLiteral( "secondsSinceReset" ), elapsed/1000.0 );
+
+        return out;
+    }
+
+    //__________________________________________________________________
+    QVariantMap PerformanceCounters::timings() const
+    {
+        QVariantMap out;
+        for( int index = 0; index < TimingCount; ++index )
+        {
+            const TimingData &data( m_timings[index] );
+
+            QVariantList histogram;
+            for( const std::atomic<quint64> &bucket : data.histogram )
+            { histogram.append( bucket.load( std::memory_order_relaxed ) ); }
+
+            const quint64 count( data.count.load( std::memory_order_relaxed ) );
+            const quint64 totalTime( data.totalTime.load( std::memory_order_relaxed ) );
+
+            QVariantMap timing;
+            timing.insert( QStringLiteral( "count" ), count );
+            timing.insert( QStringLiteral( "totalUs" ), totalTime/1000.0 );
+            timing.insert( QStringLiteral( "averageUs" ), count ? totalTime/1000.0/count : 0 );
+            timing.insert( QStringLiteral( "maxUs" ), data.maxTime.load( std::memory_order_relaxed )/1000.0 );
+            timing.insert( QStringLiteral( "histogram" ), histogram );
+            out.insert( QString::fromLatin1( s_timingNames[index] ), timing );
+        }
+
+        return out;
+    }
+
+    //__________________________________________________________________
+    void PerformanceCounters::reset()
+    {
+
+        // live decorations are created minus destroyed, keep them consistent
+        const quint64 live( m_counters[DecorationsCreated].load( std::memory_order_relaxed ) - m_counters[DecorationsDestroyed].load( std::memory_order_relaxed ) );
+        for( std::atomic<quint64> &counter : m_counters ) counter.store( 0, std::memory_order_relaxed );
+        m_counters[DecorationsCreated].store( live, std::memory_order_relaxed );
+
+        for( TimingData &data : m_timings )
+        {
+            data.count.store( 0, std::memory_order_relaxed );
+            data.totalTime.store( 0, std::memory_order_relaxed );
+            data.maxTime.store( 0, std::memory_order_relaxed );
+            for( std::atomic<quint64> &bucket : data.histogram ) bucket.store( 0, std::memory_order_relaxed );
+        }
+
+        m_timer.start();
+
+    }
+
+}
@@ -0,0 +1,145 @@
+#ifndef breezeperformancecounters_h
+#define breezeperformancecounters_h
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QVariantMap>
+
+#include <atomic>
+
+namespace Breeze
+{
+
+    //* live performance counters, exported over D-Bus on /BreezeDecoration
+    /**
+    values are accumulated with relaxed atomic operations only, so that counters can be left
+    enabled in production. They are read from within KWin's process with, for instance:
+    qdbus org.kde.KWin /BreezeDecoration org.kde.Breeze.PerformanceCounters.counters
+    */
+    class PerformanceCounters: public QObject
+    {
+
+        Q_OBJECT
+        Q_CLASSINFO( "D-Bus Interface", "org.kde.Breeze.PerformanceCounters" )
+
+        public:
+
+        //* event counters
+        enum Counter
+        {
+            DecorationsCreated,
+            DecorationsDestroyed,
+            ShadowCacheHits,
+            TitleBarTileHits,
+            TitleBarTileMisses,
+            ButtonIconHits,
+            ButtonIconMisses,
+            ResolvedSettingsHits,
+            ResolvedSettingsMisses,
+            AnimationTicks,
+            CounterCount
+        };
+
+        //* timed operations
+        enum Timing
+        {
+            Paint,
+            ShadowRendering,
+            ExceptionMatching,
+            TimingCount
+        };
+
+        //* singleton, registered on the session bus when created
+        static PerformanceCounters *self();
+
+        //* increment given counter
+        void increment( Counter counter )
+        { m_counters[counter].fetch_add( 1, std::memory_order_relaxed ); }
+
+        //* record the duration of given operation
+        void addTiming( Timing, qint64 nanoseconds );
+
+        //* records the duration of the enclosing scope
+        class ScopedTiming
+        {
+            public:
+
+            explicit ScopedTiming( Timing timing ):
+                m_timing( timing )
+            { m_timer.start(); }
+
+            ~ScopedTiming()
+            { PerformanceCounters::self()->addTiming( m_timing, m_timer.nsecsElapsed() ); }
+
+            private:
+
+            Timing m_timing;
+            QElapsedTimer m_timer;
+
+            Q_DISABLE_COPY( ScopedTiming )
+        };
+
+        public Q_SLOTS:
+
+        //* counter values by name, with the derived cache hit rates, live decorations and animation ticks per second
+        Q_SCRIPTABLE QVariantMap counters() const;
+
+        //* number of calls, total and maximum duration in microseconds, and duration histogram of each operation
+        /**
+        histogram bucket i counts the durations between 2^i and 2^(i+1) microseconds,
+        the first and last buckets also count shorter and longer durations
+        */
+        Q_SCRIPTABLE QVariantMap timings() const;
+
+        //* reset all values, except live decorations
+        Q_SCRIPTABLE void reset();
+
+        private:
+
+        //* constructor
+        PerformanceCounters();
+
+        //* number of histogram buckets
+        enum { HistogramSize = 16 };
+
+        //* accumulated durations of an operation
+        struct TimingData
+        {
+            std::atomic<quint64> count;
+            std::atomic<quint64> totalTime;
+            std::atomic<quint64> maxTime;
+            std::atomic<quint64> histogram[HistogramSize];
+        };
+
+        std::atomic<quint64> m_counters[CounterCount];
+        TimingData m_timings[TimingCount];
+
+        //* time since last reset, for rates
+        QElapsedTimer m_timer;
+
+        //* singleton
+        static PerformanceCounters *s_self;
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,55 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "breezescalefactor.h"
+
+#include <QString>
+#include <QTextStream>
+
+namespace Breeze
+{
+
+    float ScaleFactor::s_value = ScaleFactor::environmentValue();
+
+    //__________________________________________________________________
+    void ScaleFactor::reconfigure( qreal configuredValue )
+    { s_value = configuredValue > 0 ? configuredValue : environmentValue(); }
+
+    //__________________________________________________________________
+    float ScaleFactor::environmentValue()
+    {
+
+        // probonopd: Allow using BREEZE_SCALE_FACTOR
+        static const float value = []()
+        {
+            float scalefactor = 1.0;
+            if( qEnvironmentVariableIsSet( "BREEZE_SCALE_FACTOR" ) )
+            {
+                QString floatString = qEnvironmentVariable( "BREEZE_SCALE_FACTOR" );
+                QTextStream floatTextStream( &floatString );
+                floatTextStream >> scalefactor;
+            }
+
+            return scalefactor;
+        }();
+
+        return value;
+
+    }
+
+}
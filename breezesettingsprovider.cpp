@@ -21,10 +21,78 @@
 #include "breezesettingsprovider.h"
 
 #include "breezeexceptionlist.h"
+#include "breezeperformancecounters.h"
+#include "breezescalefactor.h"
+#include "breezetracer.h"
+#include "breezewindowinfocache.h"
 
-#include <KWindowInfo>
+namespace
+{
+
+    //* true if the pattern has no special meaning as a regular expression
+    bool isLiteralPattern( const QString& pattern )
+    {
+        static const QString specialCharacters( QStringLiteral( "\\^$.|?*+()[]{}" ) );
+        for( const QChar& character : pattern )
+        { if( specialCharacters.contains( character ) ) return false; }
+
+        return true;
+    }
+
+    //* values of all settings, by name
+    QHash<QString, QVariant> settingsValues( Breeze::InternalSettings* settings )
+    {
+        QHash<QString, QVariant> values;
+        foreach( KConfigSkeletonItem* item, settings->items() )
+        { values.insert( item->name(), item->property() ); }
+
+        return values;
+    }
 
-#include <QTextStream>
+    //* parts of the decoration that depend on given setting
+    Breeze::SettingsProvider::Changes affectedParts( const QString& name )
+    {
+        using Breeze::SettingsProvider;
+        static const QHash<QString, int> parts = {
+            { QStringLiteral( "ShadowStrength" ), SettingsProvider::ShadowChange },
+            { QStringLiteral( "ShadowSize" ), SettingsProvider::ShadowChange },
+            { QStringLiteral( "ShadowColor" ), SettingsProvider::ShadowChange },
+            { QStringLiteral( "ScaleFactor" ), SettingsProvider::AllChanges },
+            { QStringLiteral( "OutlineCloseButton" ), SettingsProvider::ButtonChange },
+            { QStringLiteral( "BorderSize" ), SettingsProvider::BorderChange|SettingsProvider::SizeGripChange },
+            { QStringLiteral( "TitleAlignment" ), SettingsProvider::CaptionChange },
+            { QStringLiteral( "ButtonSize" ), SettingsProvider::ButtonChange },
+            { QStringLiteral( "ButtonSpacing" ), SettingsProvider::ButtonChange },
+            { QStringLiteral( "ExtraTitleMargin" ), SettingsProvider::ButtonChange|SettingsProvider::CaptionChange },
+            { QStringLiteral( "DrawBorderOnMaximizedWindows" ), SettingsProvider::BorderChange|SettingsProvider::ButtonChange },
+            { QStringLiteral( "DrawTitleBarSeparator" ), SettingsProvider::AppearanceChange },
+            { QStringLiteral( "MacOSButtons" ), SettingsProvider::ButtonChange },
+            { QStringLiteral( "BackgroundOpacity" ), SettingsProvider::AppearanceChange },
+            { QStringLiteral( "DrawBackgroundGradient" ), SettingsProvider::AppearanceChange },
+            { QStringLiteral( "BackgroundGradientIntensity" ), SettingsProvider::AppearanceChange },
+            { QStringLiteral( "TitleBarFont" ), SettingsProvider::CaptionChange },
+            { QStringLiteral( "DrawSizeGrip" ), SettingsProvider::SizeGripChange },
+            { QStringLiteral( "AnimationsEnabled" ), SettingsProvider::AnimationChange },
+            { QStringLiteral( "AnimationsDuration" ), SettingsProvider::AnimationChange },
+            { QStringLiteral( "HideTitleBar" ), SettingsProvider::AllChanges },
+            { QStringLiteral( "OpaqueTitleBar" ), SettingsProvider::AppearanceChange },
+            { QStringLiteral( "OpacityOverride" ), SettingsProvider::AppearanceChange },
+            { QStringLiteral( "FlatTitleBar" ), SettingsProvider::AppearanceChange },
+            { QStringLiteral( "TraceFile" ), SettingsProvider::NoChange },
+
+            // only meaningful for exceptions
+            { QStringLiteral( "IsDialog" ), SettingsProvider::NoChange },
+            { QStringLiteral( "ExceptionType" ), SettingsProvider::NoChange },
+            { QStringLiteral( "ExceptionPattern" ), SettingsProvider::NoChange },
+            { QStringLiteral( "Enabled" ), SettingsProvider::NoChange },
+            { QStringLiteral( "Mask" ), SettingsProvider::NoChange }
+        };
+
+        // unknown settings might affect anything
+        return SettingsProvider::Changes( QFlag( parts.value( name, SettingsProvider::AllChanges ) ) );
+    }
+
+}
 
 namespace Breeze
 {
@@ -53,86 +121,226 @@ namespace Breeze
     //__________________________________________________________________
     void SettingsProvider::reconfigure()
     {
+
+        // everything changes the first time
+        QHash<QString, QVariant> previousValues;
         if( !m_defaultSettings )
         {
             m_defaultSettings = InternalSettingsPtr(new InternalSettings());
             m_defaultSettings->setCurrentGroup( QStringLiteral("Windeco") );
+            m_changes = AllChanges;
+        } else {
+            previousValues = settingsValues( m_defaultSettings.data() );
+            m_changes = NoChange;
         }
 
         m_defaultSettings->load();
 
+        // find out which parts of the decorations are affected
+        if( !previousValues.isEmpty() )
+        {
+            const QHash<QString, QVariant> values( settingsValues( m_defaultSettings.data() ) );
+            for( auto iter = values.constBegin(); iter != values.constEnd(); ++iter )
+            { if( previousValues.value( iter.key() ) != iter.value() ) m_changes |= affectedParts( iter.key() ); }
+        }
+
+        // scale factor
+        ScaleFactor::reconfigure( m_defaultSettings->scaleFactor() );
+
+        // tracing
+        Tracer::self()->reconfigure( m_defaultSettings->traceFile() );
+
         ExceptionList exceptions;
         exceptions.readConfig( m_config );
-        m_exceptions = exceptions.get();
 
+        // prepare matchers once, rather than for every window
+        QVector<Matcher> matchers;
+        bool hasClassExceptions = false;
+        bool hasTitleExceptions = false;
+        bool hasDialogExceptions = false;
+        foreach( auto internalSettings, exceptions.get() )
+        {
+
+            // discard disabled exceptions
+            if( !internalSettings->enabled() ) continue;
+
+            // discard exceptions with empty exception pattern
+            const QString pattern( internalSettings->exceptionPattern() );
+            if( pattern.isEmpty() ) continue;
+
+            // only the overridden values are kept, the settings themselves are created on first match
+            Matcher matcher;
+            matcher.pattern = pattern;
+            matcher.mask = internalSettings->mask();
+            matcher.borderSize = internalSettings->borderSize();
+            matcher.hideTitleBar = internalSettings->hideTitleBar();
+            matcher.opaqueTitleBar = internalSettings->opaqueTitleBar();
+            matcher.opacityOverride = internalSettings->opacityOverride();
+            matcher.flatTitleBar = internalSettings->flatTitleBar();
+            matcher.type = internalSettings->exceptionType();
+            matcher.isDialog = internalSettings->isDialog();
+            matcher.isLiteral = isLiteralPattern( pattern );
+
+            if( matcher.isLiteral ) matcher.literal = QStringMatcher( pattern );
+            else {
+
+                // invalid patterns never match
+                matcher.expression = QRegularExpression( pattern );
+                if( !matcher.expression.isValid() ) continue;
+                matcher.expression.optimize();
+
+            }
+
+            matchers.append( matcher );
+
+            if( matcher.type == InternalSettings::ExceptionWindowTitle ) hasTitleExceptions = true;
+            else hasClassExceptions = true;
+
+            if( matcher.isDialog ) hasDialogExceptions = true;
+
+        }
+
+        if( matchers == m_matchers )
+        {
+
+            // exceptions did not change. Settings and resolutions are kept, so that
+            // decorations keep their settings object and only apply what changed
+            if( m_changes )
+            {
+                for( const Matcher& matcher : m_matchers )
+                { if( matcher.settings ) applyException( matcher.settings.data(), matcher ); }
+            }
+
+        } else {
+
+            // decorations using exceptions get new settings objects and reconfigure completely
+            m_matchers = matchers;
+            m_hasClassExceptions = hasClassExceptions;
+            m_hasTitleExceptions = hasTitleExceptions;
+            m_hasDialogExceptions = hasDialogExceptions;
+            m_resolvedSettings.clear();
+
+        }
+
+    }
+
+    //__________________________________________________________________
+    InternalSettingsPtr SettingsProvider::exceptionSettings( const Matcher& matcher ) const
+    {
+
+        if( !matcher.settings )
+        {
+            matcher.settings = InternalSettingsPtr( new InternalSettings() );
+            applyException( matcher.settings.data(), matcher );
+        }
+
+        return matcher.settings;
+
+    }
+
+    //__________________________________________________________________
+    void SettingsProvider::applyException( InternalSettings* settings, const Matcher& matcher ) const
+    {
+
+        // copy default settings, without reading the configuration again
+        foreach( KConfigSkeletonItem* item, m_defaultSettings->items() )
+        {
+            if( KConfigSkeletonItem* copy = settings->findItem( item->name() ) )
+            { copy->setProperty( item->property() ); }
+        }
+
+        // apply changes from exception
+        settings->setEnabled( true );
+        settings->setExceptionType( matcher.type );
+        settings->setExceptionPattern( matcher.pattern );
+        settings->setMask( matcher.mask );
+
+        // propagate all features found in mask to the output configuration
+        if( matcher.mask & BorderSize ) settings->setBorderSize( matcher.borderSize );
+        settings->setHideTitleBar( matcher.hideTitleBar );
+        settings->setOpaqueTitleBar( matcher.opaqueTitleBar );
+        settings->setOpacityOverride( matcher.opacityOverride );
+        settings->setFlatTitleBar( matcher.flatTitleBar );
+        settings->setIsDialog( matcher.isDialog );
+
+    }
+
+    //__________________________________________________________________
+    bool SettingsProvider::Matcher::operator == ( const Matcher& other ) const
+    {
+        return pattern == other.pattern
+            && mask == other.mask
+            && borderSize == other.borderSize
+            && hideTitleBar == other.hideTitleBar
+            && opaqueTitleBar == other.opaqueTitleBar
+            && opacityOverride == other.opacityOverride
+            && flatTitleBar == other.flatTitleBar
+            && type == other.type
+            && isDialog == other.isDialog;
+    }
+
+    //__________________________________________________________________
+    bool SettingsProvider::Matcher::matches( const QString& value ) const
+    {
+        if( isLiteral ) return literal.indexIn( value ) >= 0;
+        else return expression.match( value ).hasMatch();
     }
 
     //__________________________________________________________________
     InternalSettingsPtr SettingsProvider::internalSettings( Decoration *decoration ) const
     {
 
-        QString windowTitle;
-        QString className;
+        const Tracer::Span span( "SettingsProvider::internalSettings", decoration );
+
+        // nothing to match
+        if( m_matchers.isEmpty() ) return m_defaultSettings;
 
         // get the client
         auto client = decoration->client().data();
 
-        foreach( auto internalSettings, m_exceptions )
+        // retrieve only the window properties exceptions depend on
+        ResolutionKey key;
+        if( m_hasClassExceptions ) key.className = WindowInfoCache::self()->windowClass( client->windowId() );
+        if( m_hasTitleExceptions ) key.title = client->caption();
+        if( m_hasDialogExceptions ) key.isDialog = WindowInfoCache::self()->isDialog( client->windowId() );
+
+        // windows with the same properties share the result
+        const auto iter = m_resolvedSettings.constFind( key );
+        if( iter != m_resolvedSettings.constEnd() )
         {
+            PerformanceCounters::self()->increment( PerformanceCounters::ResolvedSettingsHits );
+            return iter.value();
+        }
 
-            // discard disabled exceptions
-            if( !internalSettings->enabled() ) continue;
+        PerformanceCounters::self()->increment( PerformanceCounters::ResolvedSettingsMisses );
+        const PerformanceCounters::ScopedTiming timing( PerformanceCounters::ExceptionMatching );
 
-            // discard exceptions with empty exception pattern
-            if( internalSettings->exceptionPattern().isEmpty() ) continue;
+        InternalSettingsPtr resolved( m_defaultSettings );
+        for( const Matcher& matcher : m_matchers )
+        {
 
-            if (internalSettings->isDialog())
-            {
-                KWindowInfo info(client->windowId(), NET::WMWindowType);
-                if (info.valid()
-                    && info.windowType(NET::NormalMask | NET::DialogMask) != NET::Dialog) {
-                    continue;
-                }
-            }
+            if( matcher.isDialog && !key.isDialog ) continue;
 
             /*
             decide which value is to be compared
             to the regular expression, based on exception type
             */
-            QString value;
-            switch( internalSettings->exceptionType() )
-            {
-                case InternalSettings::ExceptionWindowTitle:
-                {
-                    value = windowTitle.isEmpty() ? (windowTitle = client->caption()):windowTitle;
-                    break;
-                }
-
-                default:
-                case InternalSettings::ExceptionWindowClassName:
-                {
-                    if( className.isEmpty() )
-                    {
-                        // retrieve class name
-                        KWindowInfo info( client->windowId(), nullptr, NET::WM2WindowClass );
-                        QString window_className( QString::fromUtf8(info.windowClassName()) );
-                        QString window_class( QString::fromUtf8(info.windowClassClass()) );
-                        className = window_className + QStringLiteral(" ") + window_class;
-                    }
-
-                    value = className;
-                    break;
-                }
-
-            }
+            const QString& value( matcher.type == InternalSettings::ExceptionWindowTitle ? key.title:key.className );
 
             // check matching
-            if( QRegExp( internalSettings->exceptionPattern() ).indexIn( value ) >= 0 )
-            { return internalSettings; }
+            if( matcher.matches( value ) )
+            {
+                resolved = exceptionSettings( matcher );
+                break;
+            }
 
         }
 
-        return m_defaultSettings;
+        // titles change often, do not let stale ones accumulate
+        if( m_resolvedSettings.size() >= 1024 ) m_resolvedSettings.clear();
+        m_resolvedSettings.insert( key, resolved );
+
+        return resolved;
 
     }
 
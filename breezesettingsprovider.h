@@ -26,7 +26,11 @@
 
 #include <KSharedConfig>
 
+#include <QHash>
 #include <QObject>
+#include <QRegularExpression>
+#include <QStringMatcher>
+#include <QVector>
 
 namespace Breeze
 {
@@ -38,6 +42,22 @@ namespace Breeze
 
         public:
 
+        //* parts of the decorations affected by a reconfiguration
+        enum Change
+        {
+            NoChange = 0,
+            ShadowChange = 1<<0,
+            BorderChange = 1<<1,
+            CaptionChange = 1<<2,
+            ButtonChange = 1<<3,
+            AnimationChange = 1<<4,
+            SizeGripChange = 1<<5,
+            AppearanceChange = 1<<6,
+            AllChanges = 0x7f
+        };
+
+        Q_DECLARE_FLAGS( Changes, Change )
+
         //* destructor
         ~SettingsProvider();
 
@@ -47,6 +67,18 @@ namespace Breeze
         //* internal settings for given decoration
         InternalSettingsPtr internalSettings(Decoration *) const;
 
+        //* parts of the decorations affected by the last reconfiguration of the default settings
+        /**
+        decorations whose settings object changed, because exceptions were modified,
+        must be reconfigured completely
+        */
+        Changes changes() const
+        { return m_changes; }
+
+        //* true if some exceptions match window titles, so that settings depend on the caption
+        bool hasTitleExceptions() const
+        { return m_hasTitleExceptions; }
+
         public Q_SLOTS:
 
         //* reconfigure
@@ -60,8 +92,86 @@ namespace Breeze
         //* default configuration
         InternalSettingsPtr m_defaultSettings;
 
-        //* exceptions
-        InternalSettingsList m_exceptions;
+        //* exception, prepared for matching
+        struct Matcher
+        {
+            //* settings to use when matching, created from the defaults on first match
+            mutable InternalSettingsPtr settings;
+
+            //*@name settings overridden by the exception
+            //@{
+            QString pattern;
+            int mask = 0;
+            int borderSize = 0;
+            bool hideTitleBar = false;
+            bool opaqueTitleBar = false;
+            int opacityOverride = -1;
+            bool flatTitleBar = false;
+            //@}
+
+            //* exception type
+            int type = InternalSettings::ExceptionWindowClassName;
+
+            //* true if the exception only applies to dialogs
+            bool isDialog = false;
+
+            //* true if the pattern has no special characters and is matched as plain text
+            bool isLiteral = false;
+
+            //* plain text matcher
+            QStringMatcher literal;
+
+            //* compiled pattern
+            QRegularExpression expression;
+
+            //* true if given value matches
+            bool matches( const QString& ) const;
+
+            //* true if both exceptions have the same pattern and overrides
+            bool operator == ( const Matcher& ) const;
+
+        };
+
+        //* default settings, with the overrides of given exception applied
+        InternalSettingsPtr exceptionSettings( const Matcher& ) const;
+
+        //* copy default settings into given settings and apply the overrides of given exception
+        void applyException( InternalSettings*, const Matcher& ) const;
+
+        //* changes from the last reconfiguration
+        Changes m_changes = AllChanges;
+
+        //* enabled exceptions, in order
+        QVector<Matcher> m_matchers;
+
+        //*@name exception types in use, so that only needed window properties are retrieved
+        //@{
+        bool m_hasClassExceptions = false;
+        bool m_hasTitleExceptions = false;
+        bool m_hasDialogExceptions = false;
+        //@}
+
+        //* window properties settings are resolved from
+        struct ResolutionKey
+        {
+            QString className;
+            QString title;
+            bool isDialog = false;
+
+            bool operator == ( const ResolutionKey& other ) const
+            { return isDialog == other.isDialog && className == other.className && title == other.title; }
+
+            friend uint qHash( const ResolutionKey& key, uint seed = 0 )
+            {
+                // chain the seed, so that equal class and title do not cancel out
+                seed = qHash( key.className, seed );
+                seed = qHash( key.title, seed );
+                return qHash( key.isDialog, seed );
+            }
+        };
+
+        //* resolved settings, shared by windows with the same properties. Cleared on reconfigure
+        mutable QHash<ResolutionKey, InternalSettingsPtr> m_resolvedSettings;
 
         //* config object
         KSharedConfigPtr m_config;
@@ -71,6 +181,8 @@ namespace Breeze
 
     };
 
+    Q_DECLARE_OPERATORS_FOR_FLAGS( SettingsProvider::Changes )
+
 }
 
 #endif
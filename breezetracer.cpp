@@ -0,0 +1,168 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "breezetracer.h"
+
+#include <KDecoration2/DecoratedClient>
+#include <KDecoration2/Decoration>
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QThread>
+
+namespace
+{
+
+    //* write data to given file, truncating it first if requested
+    void writeTrace( const QString &fileName, const QByteArray &data, bool truncate )
+    {
+        QFile file( fileName );
+        if( file.open( truncate ? QIODevice::WriteOnly|QIODevice::Truncate : QIODevice::WriteOnly|QIODevice::Append ) )
+        { file.write( data ); }
+    }
+
+}
+
+namespace Breeze
+{
+
+    bool Tracer::s_enabled = false;
+    Tracer *Tracer::s_self = nullptr;
+
+    //__________________________________________________________________
+    Tracer *Tracer::self()
+    {
+        if( !s_self )
+        { s_self = new Tracer(); }
+
+        return s_self;
+    }
+
+    //__________________________________________________________________
+    Tracer::Tracer()
+    {
+        m_writer.setMaxThreadCount( 1 );
+        m_timer.start();
+
+        m_flushTimer.setInterval( 1000 );
+        connect( &m_flushTimer, &QTimer::timeout, this, &Tracer::flush );
+
+        if( QCoreApplication::instance() )
+        { connect( QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, &Tracer::finish ); }
+    }
+
+    //__________________________________________________________________
+    void Tracer::reconfigure( const QString &configuredFile )
+    {
+
+        const QString fileName( configuredFile.isEmpty() ? qEnvironmentVariable( "BREEZE_TRACE_FILE" ) : configuredFile );
+        if( fileName == m_fileName ) return;
+
+        finish();
+
+        m_fileName = fileName;
+        s_enabled = !m_fileName.isEmpty();
+        if( !s_enabled ) return;
+
+        m_firstEvent = true;
+        m_writer.start( [fileName]() { writeTrace( fileName, QByteArrayLiteral( "[\n" ), true ); } );
+        m_flushTimer.start();
+
+    }
+
+    //__________________________________________________________________
+    void Tracer::flush()
+    {
+        if( m_buffer.isEmpty() ) return;
+
+        const QString fileName( m_fileName );
+        const QByteArray data( m_buffer );
+        m_buffer.clear();
+        m_writer.start( [fileName, data]() { writeTrace( fileName, data, false ); } );
+    }
+
+    //__________________________________________________________________
+    void Tracer::finish()
+    {
+        if( !s_enabled ) return;
+
+        flush();
+
+        const QString fileName( m_fileName );
+        m_writer.start( [fileName]() { writeTrace( fileName, QByteArrayLiteral( "\n]\n" ), false ); } );
+        m_writer.waitForDone();
+
+        m_flushTimer.stop();
+        m_fileName.clear();
+        s_enabled = false;
+    }
+
+    //__________________________________________________________________
+    void Tracer::addEvent( const char *name, qint64 start, qint64 duration, quint64 windowId, uint captionHash )
+    {
+
+        // complete events, timestamps in microseconds
+        if( !m_firstEvent ) m_buffer.append( ",\n" );
+        m_firstEvent = false;
+
+        m_buffer.append( "{\"name\":\"" ).append( name )
+            .append( "\",\"cat\":\"breeze\",\"ph\":\"X\",\"ts\":" ).append( QByteArray::number( start/1000.0, 'f', 3 ) )
+            .append( ",\"dur\":" ).append( QByteArray::number( duration/1000.0, 'f', 3 ) )
+            .append( ",\"pid\":" ).append( QByteArray::number( QCoreApplication::applicationPid() ) )
+            .append( ",\"tid\":" ).append( QByteArray::number( quintptr( QThread::currentThreadId() ) ) );
+
+        if( windowId )
+        {
+            m_buffer.append( ",\"args\":{\"window\":" ).append( QByteArray::number( windowId ) )
+                .append( ",\"caption\":" ).append( QByteArray::number( captionHash ) ).append( '}' );
+        }
+
+        m_buffer.append( '}' );
+
+        if( m_buffer.size() > MaxBufferSize ) flush();
+
+    }
+
+    //__________________________________________________________________
+    void Tracer::Span::begin( const char *name, const KDecoration2::Decoration *decoration )
+    {
+        m_name = name;
+        if( decoration )
+        {
+            // captions are hashed, so that traces can be shared without leaking window contents
+            if( auto client = decoration->client().data() )
+            {
+                m_windowId = client->windowId();
+                m_captionHash = qHash( client->caption() );
+            }
+        }
+
+        m_start = Tracer::self()->m_timer.nsecsElapsed();
+    }
+
+    //__________________________________________________________________
+    void Tracer::Span::end()
+    {
+        // tracing may have been disabled while the span was open
+        if( !s_enabled ) return;
+
+        Tracer *tracer( Tracer::self() );
+        tracer->addEvent( m_name, m_start, tracer->m_timer.nsecsElapsed() - m_start, m_windowId, m_captionHash );
+    }
+
+}
@@ -0,0 +1,132 @@
+#ifndef breezetracer_h
+#define breezetracer_h
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QThreadPool>
+#include <QTimer>
+
+namespace KDecoration2
+{
+    class Decoration;
+}
+
+namespace Breeze
+{
+
+    //* writes a timeline of the decoration hot paths, in the Chrome trace event format
+    /**
+    tracing is enabled by the TraceFile key of breezerc, or else by the BREEZE_TRACE_FILE
+    environment variable. The resulting file opens in chrome://tracing or ui.perfetto.dev.
+    Events are buffered in memory and appended to the file from a background thread.
+    Spans are only recorded from the main thread, where the decorations live.
+    */
+    class Tracer: public QObject
+    {
+
+        Q_OBJECT
+
+        public:
+
+        //* singleton
+        static Tracer *self();
+
+        //* true if tracing is enabled
+        static bool isEnabled()
+        { return s_enabled; }
+
+        //* enable tracing to given file, or to the file set in the environment if empty
+        void reconfigure( const QString &configuredFile );
+
+        //* records the duration of the enclosing scope, with the window ID and caption hash of given decoration
+        class Span
+        {
+            public:
+
+            //* name must be a string literal
+            explicit Span( const char *name, const KDecoration2::Decoration *decoration = nullptr )
+            { if( s_enabled ) begin( name, decoration ); }
+
+            ~Span()
+            { if( m_name ) end(); }
+
+            private:
+
+            void begin( const char*, const KDecoration2::Decoration* );
+            void end();
+
+            const char *m_name = nullptr;
+            qint64 m_start = 0;
+            quint64 m_windowId = 0;
+            uint m_captionHash = 0;
+
+            Q_DISABLE_COPY( Span )
+        };
+
+        private Q_SLOTS:
+
+        //* hand buffered events over to the writer thread
+        void flush();
+
+        //* flush, close the event array and wait for the writer thread
+        void finish();
+
+        private:
+
+        //* constructor
+        Tracer();
+
+        //* append a complete event to the buffer
+        void addEvent( const char *name, qint64 start, qint64 duration, quint64 windowId, uint captionHash );
+
+        //* output file, empty when tracing is disabled
+        QString m_fileName;
+
+        //* events not written yet
+        QByteArray m_buffer;
+
+        //* true until the first event of the file is written
+        bool m_firstEvent = true;
+
+        //* time reference for all events
+        QElapsedTimer m_timer;
+
+        //* periodic flush
+        QTimer m_flushTimer;
+
+        //* writer thread. A single thread keeps the writes in order
+        QThreadPool m_writer;
+
+        //* buffer size above which events are flushed right away, in bytes
+        enum { MaxBufferSize = 1 << 20 };
+
+        //* mirrors m_fileName, for the inline checks
+        static bool s_enabled;
+
+        //* singleton
+        static Tracer *s_self;
+
+    };
+
+}
+
+#endif
@@ -0,0 +1,234 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "breezewindowinfocache.h"
+
+#include <KWindowInfo>
+
+#include <QCoreApplication>
+
+#if BREEZE_HAVE_X11
+#include <QX11Info>
+#endif
+
+namespace Breeze
+{
+
+    #if BREEZE_HAVE_X11
+    //* scoped pointer convenience typedef
+    template <typename T> using ScopedPointer = QScopedPointer<T, QScopedPointerPodDeleter>;
+    #endif
+
+    WindowInfoCache *WindowInfoCache::s_self = nullptr;
+
+    //__________________________________________________________________
+    WindowInfoCache::WindowInfoCache()
+    {
+        #if BREEZE_HAVE_X11
+        if( QX11Info::isPlatformX11() && QCoreApplication::instance() )
+        { QCoreApplication::instance()->installNativeEventFilter( this ); }
+        #endif
+    }
+
+    //__________________________________________________________________
+    WindowInfoCache::~WindowInfoCache()
+    {
+        #if BREEZE_HAVE_X11
+        if( QCoreApplication::instance() )
+        { QCoreApplication::instance()->removeNativeEventFilter( this ); }
+        #endif
+
+        s_self = nullptr;
+    }
+
+    //__________________________________________________________________
+    WindowInfoCache *WindowInfoCache::self()
+    {
+        if( !s_self )
+        { s_self = new WindowInfoCache(); }
+
+        return s_self;
+    }
+
+    //__________________________________________________________________
+    QString WindowInfoCache::windowClass( WId window )
+    {
+
+        #if BREEZE_HAVE_X11
+        if( QX11Info::isPlatformX11() ) return entry( window ).windowClass;
+        #endif
+
+        KWindowInfo info( window, nullptr, NET::WM2WindowClass );
+        return QString::fromUtf8( info.windowClassName() ) + QStringLiteral(" ") + QString::fromUtf8( info.windowClassClass() );
+
+    }
+
+    //__________________________________________________________________
+    bool WindowInfoCache::isDialog( WId window )
+    {
+
+        #if BREEZE_HAVE_X11
+        if( QX11Info::isPlatformX11() ) return entry( window ).isDialog;
+        #endif
+
+        KWindowInfo info( window, NET::WMWindowType );
+        return !info.valid() || info.windowType( NET::NormalMask | NET::DialogMask ) == NET::Dialog;
+
+    }
+
+    //__________________________________________________________________
+    bool WindowInfoCache::nativeEventFilter( const QByteArray& eventType, void* message, long* )
+    {
+
+        #if BREEZE_HAVE_X11
+        if( m_entries.isEmpty() || eventType != "xcb_generic_event_t" ) return false;
+
+        auto event = static_cast<xcb_generic_event_t*>( message );
+        switch( event->response_type & ~0x80 )
+        {
+
+            case XCB_PROPERTY_NOTIFY:
+            {
+                auto propertyEvent = reinterpret_cast<xcb_property_notify_event_t*>( event );
+                if( propertyEvent->atom == XCB_ATOM_WM_CLASS || propertyEvent->atom == m_windowTypeAtom )
+                { m_entries.remove( propertyEvent->window ); }
+                break;
+            }
+
+            case XCB_DESTROY_NOTIFY:
+            {
+                m_entries.remove( reinterpret_cast<xcb_destroy_notify_event_t*>( event )->window );
+                break;
+            }
+
+            default: break;
+
+        }
+        #else
+        Q_UNUSED( eventType )
+        Q_UNUSED( message )
+        #endif
+
+        return false;
+
+    }
+
+    #if BREEZE_HAVE_X11
+
+    //__________________________________________________________________
+    void WindowInfoCache::initAtoms()
+    {
+
+        if( m_atomsValid ) return;
+        m_atomsValid = true;
+
+        auto connection( QX11Info::connection() );
+
+        static const QByteArray names[] = {
+            QByteArrayLiteral( "_NET_WM_WINDOW_TYPE" ),
+            QByteArrayLiteral( "_NET_WM_WINDOW_TYPE_NORMAL" ),
+            QByteArrayLiteral( "_NET_WM_WINDOW_TYPE_DIALOG" )
+        };
+
+        xcb_atom_t *atoms[] = { &m_windowTypeAtom, &m_normalTypeAtom, &m_dialogTypeAtom };
+
+        // send all requests before waiting for the first reply
+        xcb_intern_atom_cookie_t cookies[3];
+        for( int i = 0; i < 3; ++i )
+        { cookies[i] = xcb_intern_atom_unchecked( connection, false, names[i].size(), names[i].constData() ); }
+
+        for( int i = 0; i < 3; ++i )
+        {
+            ScopedPointer<xcb_intern_atom_reply_t> reply( xcb_intern_atom_reply( connection, cookies[i], nullptr ) );
+            *atoms[i] = reply.isNull() ? XCB_ATOM_NONE : reply->atom;
+        }
+
+    }
+
+    //__________________________________________________________________
+    const WindowInfoCache::Entry &WindowInfoCache::entry( WId window )
+    {
+
+        if( !window )
+        {
+            static const Entry invalid = []()
+            {
+                Entry entry;
+                entry.windowClass = QStringLiteral(" ");
+                return entry;
+            }();
+
+            return invalid;
+        }
+
+        auto iter = m_entries.constFind( window );
+        if( iter != m_entries.constEnd() ) return iter.value();
+
+        initAtoms();
+
+        auto connection( QX11Info::connection() );
+
+        // send both requests before waiting for the first reply
+        const xcb_get_property_cookie_t classCookie = xcb_get_property_unchecked( connection, false, window, XCB_ATOM_WM_CLASS, XCB_ATOM_STRING, 0, 2048 );
+        const xcb_get_property_cookie_t typeCookie = xcb_get_property_unchecked( connection, false, window, m_windowTypeAtom, XCB_ATOM_ATOM, 0, 32 );
+
+        Entry entry;
+
+        // WM_CLASS holds the window class name and the window class, each null terminated
+        QByteArray className;
+        QByteArray classClass;
+        ScopedPointer<xcb_get_property_reply_t> classReply( xcb_get_property_reply( connection, classCookie, nullptr ) );
+        if( !classReply.isNull() && classReply->format == 8 )
+        {
+            const QByteArray value( static_cast<const char*>( xcb_get_property_value( classReply.data() ) ), xcb_get_property_value_length( classReply.data() ) );
+            const QList<QByteArray> parts( value.split( '\0' ) );
+            className = parts.value( 0 );
+            classClass = parts.value( 1 );
+        }
+
+        entry.windowClass = QString::fromUtf8( className ) + QStringLiteral(" ") + QString::fromUtf8( classClass );
+
+        // the first of the normal and dialog types wins, as in KWindowInfo
+        ScopedPointer<xcb_get_property_reply_t> typeReply( xcb_get_property_reply( connection, typeCookie, nullptr ) );
+        if( typeReply.isNull() ) entry.isDialog = true;
+        else {
+
+            entry.isDialog = false;
+            if( typeReply->format == 32 )
+            {
+                const auto types = static_cast<const xcb_atom_t*>( xcb_get_property_value( typeReply.data() ) );
+                const int count = xcb_get_property_value_length( typeReply.data() )/sizeof( xcb_atom_t );
+                for( int i = 0; i < count; ++i )
+                {
+                    if( types[i] == m_normalTypeAtom ) break;
+                    else if( types[i] == m_dialogTypeAtom ) {
+                        entry.isDialog = true;
+                        break;
+                    }
+                }
+            }
+
+        }
+
+        return m_entries.insert( window, entry ).value();
+
+    }
+
+    #endif
+
+}
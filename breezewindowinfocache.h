@@ -0,0 +1,106 @@
+#ifndef breezewindowinfocache_h
+#define breezewindowinfocache_h
+
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License or (at your option) version 3 or any later version
+ * accepted by the membership of KDE e.V. (or its successor approved
+ * by the membership of KDE e.V.), which shall act as a proxy
+ * defined in Section 14 of version 3 of the license.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config-breeze.h"
+
+#include <QAbstractNativeEventFilter>
+#include <QHash>
+#include <QString>
+#include <qwindowdefs.h>
+
+#if BREEZE_HAVE_X11
+#include <xcb/xcb.h>
+#endif
+
+namespace Breeze
+{
+
+    //* window properties used for exception matching, fetched once per window
+    /**
+    on X11, both properties are requested before waiting for the first reply, so that they
+    share a single round trip. Values are kept until the window is destroyed or the properties
+    change. Other platforms fall back to KWindowInfo.
+    */
+    class WindowInfoCache: public QAbstractNativeEventFilter
+    {
+
+        public:
+
+        //* singleton
+        static WindowInfoCache *self();
+
+        //* delete singleton, if any, which also removes the event filter
+        static void release()
+        { delete s_self; }
+
+        //* destructor
+        ~WindowInfoCache() override;
+
+        //* window class name and window class, separated by a space
+        QString windowClass( WId );
+
+        //* true if the window is a dialog, or if its type cannot be retrieved
+        bool isDialog( WId );
+
+        //* invalidate cached values on property change
+        bool nativeEventFilter( const QByteArray&, void*, long* ) override;
+
+        private:
+
+        //* constructor
+        WindowInfoCache();
+
+        #if BREEZE_HAVE_X11
+
+        //* properties of a window
+        struct Entry
+        {
+            QString windowClass;
+            bool isDialog = true;
+        };
+
+        //* intern needed atoms, once
+        void initAtoms();
+
+        //* entry for given window, fetched if not cached
+        const Entry &entry( WId );
+
+        //* cached entries
+        QHash<xcb_window_t, Entry> m_entries;
+
+        //*@name atoms
+        //@{
+        bool m_atomsValid = false;
+        xcb_atom_t m_windowTypeAtom = XCB_ATOM_NONE;
+        xcb_atom_t m_normalTypeAtom = XCB_ATOM_NONE;
+        xcb_atom_t m_dialogTypeAtom = XCB_ATOM_NONE;
+        //@}
+
+        #endif
+
+        //* singleton
+        static WindowInfoCache *s_self;
+
+    };
+
+}
+
+#endif
@@ -136,7 +136,7 @@ namespace Breeze
 
         // load exceptions
         ExceptionList exceptions;
-        exceptions.readConfig( m_configuration );
+        exceptions.readConfig( m_configuration, m_internalSettings.data() );
         m_ui.exceptions->setExceptions( exceptions.get() );
         setChanged( false );
 
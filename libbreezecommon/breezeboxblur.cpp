@@ -0,0 +1,235 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// own
+#include "breezeboxblur.h"
+
+// std
+#include <algorithm>
+#include <memory>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BREEZE_HAVE_SSE2 1
+#endif
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define BREEZE_HAVE_AVX2 1
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define BREEZE_HAVE_NEON 1
+#endif
+
+namespace Breeze
+{
+
+/**
+ * Output one row and advance the sliding window sums of all columns.
+ *
+ * @param sums The sliding window sums, one per column.
+ * @param add The row entering the window.
+ * @param sub The row leaving the window.
+ * @param out The output row.
+ * @param begin The first column to process.
+ * @param end One past the last column to process.
+ * @param reciprocal The fixed point reciprocal of the box size.
+ **/
+using BoxBlurStep = void (*)(uint32_t *sums, const uint8_t *add, const uint8_t *sub, uint8_t *out,
+                             int begin, int end, uint32_t reciprocal);
+
+static void boxBlurStepScalar(uint32_t *sums, const uint8_t *add, const uint8_t *sub, uint8_t *out,
+                              int begin, int end, uint32_t reciprocal)
+{
+    for (int x = begin; x < end; ++x) {
+        out[x] = (sums[x] * reciprocal) >> 24;
+        sums[x] += add[x] - sub[x];
+    }
+}
+
+#if BREEZE_HAVE_SSE2
+static inline __m128i mullo32(__m128i a, __m128i b)
+{
+    // SSE2 lacks a 32 bit low multiply, combine two 32x32->64 multiplies.
+    const __m128i even = _mm_mul_epu32(a, b);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static void boxBlurStepSse2(uint32_t *sums, const uint8_t *add, const uint8_t *sub, uint8_t *out,
+                            int begin, int end, uint32_t reciprocal)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i factor = _mm_set1_epi32(reciprocal);
+
+    int x = begin;
+    for (; x + 16 <= end; x += 16) {
+        const __m128i addBytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(add + x));
+        const __m128i subBytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sub + x));
+
+        const __m128i addWords[2] = {_mm_unpacklo_epi8(addBytes, zero), _mm_unpackhi_epi8(addBytes, zero)};
+        const __m128i subWords[2] = {_mm_unpacklo_epi8(subBytes, zero), _mm_unpackhi_epi8(subBytes, zero)};
+
+        __m128i result[4];
+        for (int i = 0; i < 4; ++i) {
+            __m128i *sum = reinterpret_cast<__m128i *>(sums + x + 4 * i);
+            const __m128i value = _mm_loadu_si128(sum);
+            result[i] = _mm_srli_epi32(mullo32(value, factor), 24);
+
+            const __m128i addWord = addWords[i / 2];
+            const __m128i subWord = subWords[i / 2];
+            const __m128i addValue = (i % 2) ? _mm_unpackhi_epi16(addWord, zero) : _mm_unpacklo_epi16(addWord, zero);
+            const __m128i subValue = (i % 2) ? _mm_unpackhi_epi16(subWord, zero) : _mm_unpacklo_epi16(subWord, zero);
+            _mm_storeu_si128(sum, _mm_sub_epi32(_mm_add_epi32(value, addValue), subValue));
+        }
+
+        // Results are at most 255, so saturating packs are exact.
+        const __m128i words0 = _mm_packs_epi32(result[0], result[1]);
+        const __m128i words1 = _mm_packs_epi32(result[2], result[3]);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x), _mm_packus_epi16(words0, words1));
+    }
+
+    boxBlurStepScalar(sums, add, sub, out, x, end, reciprocal);
+}
+#endif
+
+#if BREEZE_HAVE_AVX2
+__attribute__((target("avx2")))
+static void boxBlurStepAvx2(uint32_t *sums, const uint8_t *add, const uint8_t *sub, uint8_t *out,
+                            int begin, int end, uint32_t reciprocal)
+{
+    const __m256i factor = _mm256_set1_epi32(reciprocal);
+
+    int x = begin;
+    for (; x + 8 <= end; x += 8) {
+        const __m256i addValue = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(add + x)));
+        const __m256i subValue = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(sub + x)));
+
+        __m256i *sum = reinterpret_cast<__m256i *>(sums + x);
+        const __m256i value = _mm256_loadu_si256(sum);
+        const __m256i result = _mm256_srli_epi32(_mm256_mullo_epi32(value, factor), 24);
+        _mm256_storeu_si256(sum, _mm256_sub_epi32(_mm256_add_epi32(value, addValue), subValue));
+
+        // Results are at most 255, so saturating packs are exact.
+        const __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(result), _mm256_extracti128_si256(result, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(out + x), _mm_packus_epi16(words, words));
+    }
+
+    boxBlurStepScalar(sums, add, sub, out, x, end, reciprocal);
+}
+#endif
+
+#if BREEZE_HAVE_NEON
+static void boxBlurStepNeon(uint32_t *sums, const uint8_t *add, const uint8_t *sub, uint8_t *out,
+                            int begin, int end, uint32_t reciprocal)
+{
+    int x = begin;
+    for (; x + 8 <= end; x += 8) {
+        const uint16x8_t addWords = vmovl_u8(vld1_u8(add + x));
+        const uint16x8_t subWords = vmovl_u8(vld1_u8(sub + x));
+
+        const uint32x4_t low = vld1q_u32(sums + x);
+        const uint32x4_t high = vld1q_u32(sums + x + 4);
+
+        const uint32x4_t lowResult = vshrq_n_u32(vmulq_n_u32(low, reciprocal), 24);
+        const uint32x4_t highResult = vshrq_n_u32(vmulq_n_u32(high, reciprocal), 24);
+
+        vst1q_u32(sums + x, vsubq_u32(vaddq_u32(low, vmovl_u16(vget_low_u16(addWords))), vmovl_u16(vget_low_u16(subWords))));
+        vst1q_u32(sums + x + 4, vsubq_u32(vaddq_u32(high, vmovl_u16(vget_high_u16(addWords))), vmovl_u16(vget_high_u16(subWords))));
+
+        vst1_u8(out + x, vmovn_u16(vcombine_u16(vmovn_u32(lowResult), vmovn_u32(highResult))));
+    }
+
+    boxBlurStepScalar(sums, add, sub, out, x, end, reciprocal);
+}
+#endif
+
+struct BoxBlurBackend
+{
+    BoxBlurStep step;
+    const char *name;
+};
+
+static BoxBlurBackend selectBoxBlurBackend()
+{
+#if BREEZE_HAVE_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        return {boxBlurStepAvx2, "avx2"};
+    }
+#endif
+
+#if BREEZE_HAVE_SSE2
+    return {boxBlurStepSse2, "sse2"};
+#elif BREEZE_HAVE_NEON
+    return {boxBlurStepNeon, "neon"};
+#else
+    return {boxBlurStepScalar, "scalar"};
+#endif
+}
+
+static const BoxBlurBackend &boxBlurBackend()
+{
+    static const BoxBlurBackend backend = selectBoxBlurBackend();
+    return backend;
+}
+
+void boxBlurColumnsAlpha(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                         int width, int height, const BoxLobes &lobes)
+{
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+
+    const BoxBlurStep step = boxBlurBackend().step;
+
+    const int boxSize = lobes.left + 1 + lobes.right;
+    const uint32_t reciprocal = (1 << 24) / boxSize;
+
+    auto row = [src, srcStride, height](int index) {
+        return src + std::min(std::max(index, 0), height - 1) * srcStride;
+    };
+
+    // Seed the window with the first value repeated on the left and the
+    // first values of the column on the right, as boxBlurRowAlpha does.
+    std::unique_ptr<uint32_t[]> sums(new uint32_t[width]);
+    const uint8_t *first = row(0);
+    for (int x = 0; x < width; ++x) {
+        sums[x] = (boxSize + 1) / 2 + first[x] * lobes.left;
+    }
+
+    for (int i = 0; i <= lobes.right; ++i) {
+        const uint8_t *in = row(i);
+        for (int x = 0; x < width; ++x) {
+            sums[x] += in[x];
+        }
+    }
+
+    // Slide the window down, values outside of the plane are clamped
+    // to the first and the last row.
+    for (int y = 0; y < height; ++y) {
+        step(sums.get(), row(y + lobes.right + 1), row(y - lobes.left), dst + y * dstStride, 0, width, reciprocal);
+    }
+}
+
+const char *boxBlurBackendName()
+{
+    return boxBlurBackend().name;
+}
+
+} // namespace Breeze
@@ -0,0 +1,75 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#pragma once
+
+// own
+#include "breezecommon_export.h"
+
+// Qt
+#include <QRect>
+
+// std
+#include <cstdint>
+
+class QImage;
+
+namespace Breeze
+{
+
+struct BoxLobes
+{
+    int left;  ///< how many pixels sample to the left
+    int right; ///< how many pixels sample to the right
+};
+
+/**
+ * Process all columns of a tightly packed alpha plane with a box filter.
+ *
+ * The plane is walked row by row and the sliding window sums of all columns
+ * are updated at once, which keeps memory accesses sequential and lets the
+ * filter use SIMD instructions when they are available. The result is
+ * identical to filtering each column separately.
+ *
+ * @param src The first row of the input plane.
+ * @param srcStride The number of bytes from one input row to the next one.
+ * @param dst The first row of the output plane. Must not overlap the input.
+ * @param dstStride The number of bytes from one output row to the next one.
+ * @param width The number of columns.
+ * @param height The number of rows.
+ * @param lobes Params of the box filter.
+ **/
+BREEZECOMMON_EXPORT void boxBlurColumnsAlpha(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride,
+                                             int width, int height, const BoxLobes &lobes);
+
+/**
+ * Blur an alpha-only image with three box filters in each direction.
+ *
+ * Defined with the shadow renderer, which derives the box filters from the radius.
+ *
+ * @param image The input image, must be in the Format_Alpha8 format.
+ * @param radius The blur radius.
+ * @param rect Specifies what part of the image to blur. If nothing is provided, then
+ *    the whole image will be blurred.
+ **/
+BREEZECOMMON_EXPORT void boxBlurAlpha(QImage &image, int radius, const QRect &rect = QRect());
+
+/**
+ * @returns The name of the instruction set used by boxBlurColumnsAlpha.
+ **/
+BREEZECOMMON_EXPORT const char *boxBlurBackendName();
+
+} // namespace Breeze
@@ -20,6 +20,7 @@
 
 // own
 #include "breezeboxshadowrenderer.h"
+#include "breezeboxblur.h"
 
 // Qt
 #include <QPainter>
@@ -47,12 +48,6 @@ static inline QSize calculateBlurExtent(int radius)
     return QSize(blurRadius, blurRadius);
 }
 
-struct BoxLobes
-{
-    int left;  ///< how many pixels sample to the left
-    int right; ///< how many pixels sample to the right
-};
-
 /**
  * Compute box filter parameters.
  *
@@ -105,22 +100,17 @@ static QVector<BoxLobes> computeLobes(int radius)
  * Process a row with a box filter.
  *
  * @param src The start of the row.
- * @param dst The destination.
+ * @param dst The destination. Must not overlap the source.
  * @param width The width of the row, in pixels.
- * @param horizontalStride The number of bytes from one alpha value to the
- *    next alpha value.
- * @param verticalStride The number of bytes from one row to the next row.
+ * @param inputStep The number of bytes from one input alpha value to the
+ *    next input alpha value.
+ * @param outputStep The number of bytes from one output alpha value to the
+ *    next output alpha value.
  * @param lobes Params of the box filter.
- * @param transposeInput Whether the input is transposed.
- * @param transposeOutput Whether the output should be transposed.
  **/
-static inline void boxBlurRowAlpha(const uint8_t *src, uint8_t *dst, int width, int horizontalStride,
-                                   int verticalStride, const BoxLobes &lobes, bool transposeInput,
-                                   bool transposeOutput)
+static inline void boxBlurRowAlpha(const uint8_t *src, uint8_t *dst, int width, int inputStep,
+                                   int outputStep, const BoxLobes &lobes)
 {
-    const int inputStep = transposeInput ? verticalStride : horizontalStride;
-    const int outputStep = transposeOutput ? verticalStride : horizontalStride;
-
     const int boxSize = lobes.left + 1 + lobes.right;
     const int reciprocal = (1 << 24) / boxSize;
 
@@ -167,16 +157,10 @@ static inline void boxBlurRowAlpha(const uint8_t *src, uint8_t *dst, int width,
     }
 }
 
-/**
- * Blur the alpha channel of a given image.
- *
- * @param image The input image.
- * @param radius The blur radius.
- * @param rect Specifies what part of the image to blur. If nothing is provided, then
- *    the whole alpha channel of the input image will be blurred.
- **/
-static inline void boxBlurAlpha(QImage &image, int radius, const QRect &rect = {})
+void boxBlurAlpha(QImage &image, int radius, const QRect &rect)
 {
+    Q_ASSERT(image.format() == QImage::Format_Alpha8);
+
     if (radius < 2) {
         return;
     }
@@ -185,74 +169,193 @@ static inline void boxBlurAlpha(QImage &image, int radius, const QRect &rect = {
 
     const QRect blurRect = rect.isNull() ? image.rect() : rect;
 
-    const int alphaOffset = QSysInfo::ByteOrder == QSysInfo::BigEndian ? 0 : 3;
     const int width = blurRect.width();
     const int height = blurRect.height();
-    const int rowStride = image.bytesPerLine();
-    const int pixelStride = image.depth() >> 3;
+    const int stride = image.bytesPerLine();
+    uint8_t *origin = image.bits() + blurRect.y() * stride + blurRect.x();
 
-    const int bufferStride = qMax(width, height) * pixelStride;
-    QScopedPointer<uint8_t, QScopedPointerArrayDeleter<uint8_t> > buf(new uint8_t[2 * bufferStride]);
-    uint8_t *buf1 = buf.data();
-    uint8_t *buf2 = buf1 + bufferStride;
+    // The intermediate passes go through two tightly packed planes, so that the
+    // vertical passes can process all columns at once instead of walking the
+    // image column by column.
+    const int planeSize = width * height;
+    QScopedPointer<uint8_t, QScopedPointerArrayDeleter<uint8_t> > buf(new uint8_t[2 * planeSize]);
+    uint8_t *plane1 = buf.data();
+    uint8_t *plane2 = plane1 + planeSize;
 
     // Blur the image in horizontal direction.
     for (int i = 0; i < height; ++i) {
-        uint8_t *row = image.scanLine(blurRect.y() + i) + blurRect.x() * pixelStride + alphaOffset;
-        boxBlurRowAlpha(row, buf1, width, pixelStride, rowStride, lobes[0], false, false);
-        boxBlurRowAlpha(buf1, buf2, width, pixelStride, rowStride, lobes[1], false, false);
-        boxBlurRowAlpha(buf2, row, width, pixelStride, rowStride, lobes[2], false, false);
+        const uint8_t *row = origin + i * stride;
+        uint8_t *row1 = plane1 + i * width;
+        uint8_t *row2 = plane2 + i * width;
+        boxBlurRowAlpha(row, row2, width, 1, 1, lobes[0]);
+        boxBlurRowAlpha(row2, row1, width, 1, 1, lobes[1]);
+        boxBlurRowAlpha(row1, row2, width, 1, 1, lobes[2]);
     }
 
-    // Blur the image in vertical direction.
-    for (int i = 0; i < width; ++i) {
-        uint8_t *column = image.scanLine(blurRect.y()) + (blurRect.x() + i) * pixelStride + alphaOffset;
-        boxBlurRowAlpha(column, buf1, height, pixelStride, rowStride, lobes[0], true, false);
-        boxBlurRowAlpha(buf1, buf2, height, pixelStride, rowStride, lobes[1], false, false);
-        boxBlurRowAlpha(buf2, column, height, pixelStride, rowStride, lobes[2], false, true);
+    // Blur the image in vertical direction, the last pass writes straight
+    // back into the image.
+    boxBlurColumnsAlpha(plane2, width, plane1, width, width, height, lobes[0]);
+    boxBlurColumnsAlpha(plane1, width, plane2, width, width, height, lobes[1]);
+    boxBlurColumnsAlpha(plane2, width, origin, stride, width, height, lobes[2]);
+}
+
+/**
+ * Compute the standard deviation of three consecutive box filters.
+ *
+ * @param lobes Params of the box filters.
+ **/
+static qreal computeLobesStdDev(const QVector<BoxLobes> &lobes)
+{
+    qreal variance = 0.0;
+    for (const BoxLobes &lobe : lobes) {
+        const int boxSize = lobe.left + 1 + lobe.right;
+        variance += (boxSize * boxSize - 1) / 12.0;
     }
+    return qSqrt(variance);
 }
 
-static inline void mirrorTopLeftQuadrant(QImage &image)
+/**
+ * Approximation of the error function (Abramowitz and Stegun 7.1.27), the maximum error is below 5e-4.
+ **/
+static inline qreal approximateErf(qreal x)
 {
-    const int width = image.width();
-    const int height = image.height();
+    const qreal sign = x < 0 ? -1.0 : 1.0;
+    const qreal a = qAbs(x);
+    qreal t = 1.0 + (0.278393 + (0.230389 + (0.000972 + 0.078108 * a) * a) * a) * a;
+    t *= t;
+    return sign - sign / (t * t);
+}
 
-    const int centerX = qCeil(width * 0.5);
-    const int centerY = qCeil(height * 0.5);
+/**
+ * Render a Gaussian-blurred rounded box into an alpha-only image.
+ *
+ * The blur is integrated analytically in horizontal direction and sampled
+ * at four points in vertical direction, so the cost per pixel doesn't depend
+ * on the blur radius.
+ *
+ * @param image The output image, must be in the Format_Alpha8 format.
+ * @param box The geometry of the box, in device pixels.
+ * @param cornerRadius The radius of box' corners, in device pixels.
+ * @param stdDev The standard deviation of the blur, in device pixels.
+ * @param rect Specifies what part of the image to render.
+ **/
+static void renderGaussianBoxAlpha(QImage &image, const QRectF &box, qreal cornerRadius, qreal stdDev, const QRect &rect)
+{
+    Q_ASSERT(image.format() == QImage::Format_Alpha8);
+
+    const int sampleCount = 4;
+
+    const QPointF center = box.center();
+    const qreal halfWidth = box.width() * 0.5;
+    const qreal halfHeight = box.height() * 0.5;
+    const qreal corner = qMin(cornerRadius, qMin(halfWidth, halfHeight));
+    const qreal erfScale = qSqrt(0.5) / stdDev;
+    const qreal gaussianScale = 1.0 / (qSqrt(2.0 * M_PI) * stdDev);
+
+    for (int y = rect.top(); y <= rect.bottom(); ++y) {
+        const qreal pointY = y + 0.5 - center.y();
+
+        // Only the part of the box within three standard deviations matters.
+        const qreal start = qBound(pointY - halfHeight, -3.0 * stdDev, pointY + halfHeight);
+        const qreal end = qBound(pointY - halfHeight, 3.0 * stdDev, pointY + halfHeight);
+        const qreal step = (end - start) / sampleCount;
+
+        // Half-width of the box and weight at each vertical sample, these
+        // depend only on the row.
+        qreal extents[sampleCount];
+        qreal weights[sampleCount];
+        for (int i = 0; i < sampleCount; ++i) {
+            const qreal sampleY = start + (i + 0.5) * step;
+            const qreal delta = qMin(halfHeight - corner - qAbs(pointY - sampleY), 0.0);
+            extents[i] = (halfWidth - corner + qSqrt(qMax(0.0, corner * corner - delta * delta))) * erfScale;
+            weights[i] = 0.5 * gaussianScale * qExp(-(sampleY * sampleY) / (2.0 * stdDev * stdDev)) * step;
+        }
 
-    const int alphaOffset = QSysInfo::ByteOrder == QSysInfo::BigEndian ? 0 : 3;
-    const int stride = image.depth() >> 3;
+        uint8_t *out = image.scanLine(y);
+        for (int x = rect.left(); x <= rect.right(); ++x) {
+            const qreal pointX = (x + 0.5 - center.x()) * erfScale;
 
-    for (int y = 0; y < centerY; ++y) {
-        uint8_t *in = image.scanLine(y) + alphaOffset;
-        uint8_t *out = in + (width - 1) * stride;
+            qreal value = 0.0;
+            for (int i = 0; i < sampleCount; ++i) {
+                value += weights[i] * (approximateErf(pointX + extents[i]) - approximateErf(pointX - extents[i]));
+            }
 
-        for (int x = 0; x < centerX; ++x, in += stride, out -= stride) {
-            *out = *in;
+            out[x] = qRound(qBound(0.0, value, 1.0) * 255);
         }
     }
+}
 
-    for (int y = 0; y < centerY; ++y) {
-        const uint8_t *in = image.scanLine(y) + alphaOffset;
-        uint8_t *out = image.scanLine(width - y - 1) + alphaOffset;
+static inline uint multiplyAlpha(uint value, uint alpha)
+{
+    const uint product = value * alpha + 128;
+    return (product + (product >> 8)) >> 8;
+}
 
-        for (int x = 0; x < width; ++x, in += stride, out += stride) {
-            *out = *in;
+/**
+ * Tint a shadow with the given color and composite it on top of the canvas.
+ *
+ * Only the top-left quadrant of the shadow is stored, the other three are
+ * its mirror images and get read straight from the quadrant.
+ *
+ * @param canvas The destination image, must be in the Format_ARGB32_Premultiplied format.
+ * @param position Top-left corner of the shadow in device pixels.
+ * @param size The size of the whole shadow in device pixels.
+ * @param quadrant The alpha-only top-left quadrant of the shadow.
+ * @param color The color of the shadow.
+ **/
+static void compositeShadow(QImage &canvas, const QPoint &position, const QSize &size, const QImage &quadrant, const QColor &color)
+{
+    Q_ASSERT(canvas.format() == QImage::Format_ARGB32_Premultiplied);
+    Q_ASSERT(quadrant.format() == QImage::Format_Alpha8);
+    Q_ASSERT(quadrant.width() == qCeil(size.width() * 0.5));
+    Q_ASSERT(quadrant.height() == qCeil(size.height() * 0.5));
+
+    const QRgb premultiplied = qPremultiply(color.rgba());
+    const uint red = qRed(premultiplied);
+    const uint green = qGreen(premultiplied);
+    const uint blue = qBlue(premultiplied);
+    const uint alpha = qAlpha(premultiplied);
+
+    const QRect targetRect = QRect(position, size) & canvas.rect();
+
+    for (int y = targetRect.top(); y <= targetRect.bottom(); ++y) {
+        const int shadowY = y - position.y();
+        const uint8_t *in = quadrant.constScanLine(qMin(shadowY, size.height() - shadowY - 1));
+        QRgb *out = reinterpret_cast<QRgb *>(canvas.scanLine(y));
+
+        for (int x = targetRect.left(); x <= targetRect.right(); ++x) {
+            const int shadowX = x - position.x();
+            const uint coverage = in[qMin(shadowX, size.width() - shadowX - 1)];
+            if (!coverage) {
+                continue;
+            }
+
+            const uint inverseAlpha = 255 - multiplyAlpha(alpha, coverage);
+            const QRgb pixel = out[x];
+            out[x] = qRgba(multiplyAlpha(red, coverage) + multiplyAlpha(qRed(pixel), inverseAlpha),
+                           multiplyAlpha(green, coverage) + multiplyAlpha(qGreen(pixel), inverseAlpha),
+                           multiplyAlpha(blue, coverage) + multiplyAlpha(qBlue(pixel), inverseAlpha),
+                           multiplyAlpha(alpha, coverage) + multiplyAlpha(qAlpha(pixel), inverseAlpha));
         }
     }
 }
 
-static void renderShadow(QPainter *painter, const QRect &rect, qreal borderRadius, const QPoint &offset, int radius, const QColor &color)
+static void renderShadow(QImage &canvas, BoxShadowRenderer::Algorithm algorithm, const QRect &rect, qreal borderRadius,
+                         const QPoint &offset, int radius, const QColor &color)
 {
     const QSize inflation = calculateBlurExtent(radius);
     const QSize size = rect.size() + 2 * inflation;
 
-    const qreal dpr = painter->device()->devicePixelRatioF();
+    const qreal dpr = canvas.devicePixelRatioF();
+    const QSize scaledSize = size * dpr;
 
-    QImage shadow(size * dpr, QImage::Format_ARGB32_Premultiplied);
+    // Because the shadow texture is symmetrical, that's enough to render
+    // only the top-left quadrant, the rest is mirrored while compositing.
+    // Only the coverage of the shadow is needed until then, so rasterize
+    // and blur it as a single byte per pixel.
+    QImage shadow(qCeil(scaledSize.width() * 0.5), qCeil(scaledSize.height() * 0.5), QImage::Format_Alpha8);
     shadow.setDevicePixelRatio(dpr);
-    shadow.fill(Qt::transparent);
+    shadow.fill(0);
 
     QRect boxRect(QPoint(0, 0), rect.size());
     boxRect.moveCenter(QRect(QPoint(0, 0), size).center());
@@ -260,32 +363,46 @@ static void renderShadow(QPainter *painter, const QRect &rect, qreal borderRadiu
     const qreal xRadius = 2.0 * borderRadius / boxRect.width();
     const qreal yRadius = 2.0 * borderRadius / boxRect.height();
 
-    QPainter shadowPainter;
-    shadowPainter.begin(&shadow);
-    shadowPainter.setRenderHint(QPainter::Antialiasing);
-    shadowPainter.setPen(Qt::NoPen);
-    shadowPainter.setBrush(Qt::black);
-    shadowPainter.drawRoundedRect(boxRect, xRadius, yRadius);
-    shadowPainter.end();
-
-    // Because the shadow texture is symmetrical, that's enough to blur
-    // only the top-left quadrant and then mirror it.
-    const QRect blurRect(0, 0, qCeil(shadow.width() * 0.5), qCeil(shadow.height() * 0.5));
     const int scaledRadius = qRound(radius * dpr);
-    boxBlurAlpha(shadow, scaledRadius, blurRect);
-    mirrorTopLeftQuadrant(shadow);
-
-    // Give the shadow a tint of the desired color.
-    shadowPainter.begin(&shadow);
-    shadowPainter.setCompositionMode(QPainter::CompositionMode_SourceIn);
-    shadowPainter.fillRect(shadow.rect(), color);
-    shadowPainter.end();
-
-    // Actually, present the shadow.
-    QRect shadowRect = shadow.rect();
-    shadowRect.setSize(shadowRect.size() / dpr);
+
+    switch (algorithm) {
+    case BoxShadowRenderer::Algorithm::BoxBlur: {
+        QPainter shadowPainter;
+        shadowPainter.begin(&shadow);
+        shadowPainter.setRenderHint(QPainter::Antialiasing);
+        shadowPainter.setPen(Qt::NoPen);
+        shadowPainter.setBrush(Qt::black);
+        shadowPainter.drawRoundedRect(boxRect, xRadius, yRadius);
+        shadowPainter.end();
+
+        boxBlurAlpha(shadow, scaledRadius);
+        break;
+    }
+
+    case BoxShadowRenderer::Algorithm::AnalyticGaussian: {
+        // Match the strength of the box filters, so both algorithms produce
+        // the same shadow.
+        const QRectF scaledBoxRect(boxRect.x() * dpr, boxRect.y() * dpr, boxRect.width() * dpr, boxRect.height() * dpr);
+        const qreal stdDev = scaledRadius < 2 ? 0.5 : computeLobesStdDev(computeLobes(scaledRadius));
+        renderGaussianBoxAlpha(shadow, scaledBoxRect, qMin(xRadius, yRadius) * dpr, stdDev, shadow.rect());
+        break;
+    }
+    }
+
+    // Actually, present the shadow with a tint of the desired color.
+    QRect shadowRect(QPoint(0, 0), scaledSize / dpr);
     shadowRect.moveCenter(rect.center() + offset);
-    painter->drawImage(shadowRect, shadow);
+    compositeShadow(canvas, (QPointF(shadowRect.topLeft()) * dpr).toPoint(), scaledSize, shadow, color);
+}
+
+void BoxShadowRenderer::setAlgorithm(Algorithm algorithm)
+{
+    m_algorithm = algorithm;
+}
+
+BoxShadowRenderer::Algorithm BoxShadowRenderer::algorithm() const
+{
+    return m_algorithm;
 }
 
 void BoxShadowRenderer::setBoxSize(const QSize &size)
@@ -331,11 +448,9 @@ QImage BoxShadowRenderer::render() const
     QRect boxRect(QPoint(0, 0), m_boxSize);
     boxRect.moveCenter(QRect(QPoint(0, 0), canvasSize).center());
 
-    QPainter painter(&canvas);
     for (const Shadow &shadow : qAsConst(m_shadows)) {
-        renderShadow(&painter, boxRect, m_borderRadius, shadow.offset, shadow.radius, shadow.color);
+        renderShadow(canvas, m_algorithm, boxRect, m_borderRadius, shadow.offset, shadow.radius, shadow.color);
     }
-    painter.end();
 
     return canvas;
 }
@@ -35,6 +35,27 @@ class BREEZECOMMON_EXPORT BoxShadowRenderer
 public:
     // Compiler generated constructors & destructor are fine.
 
+    /**
+     * Algorithms that can be used to render the shadow.
+     **/
+    enum class Algorithm {
+        /// Rasterize the box and blur it with three box filters.
+        BoxBlur,
+        /// Evaluate an approximation of the Gaussian-blurred box per pixel.
+        AnalyticGaussian,
+    };
+
+    /**
+     * Set the algorithm used to render the shadow.
+     * @param algorithm The algorithm, BoxBlur by default.
+     **/
+    void setAlgorithm(Algorithm algorithm);
+
+    /**
+     * @returns The algorithm used to render the shadow.
+     **/
+    Algorithm algorithm() const;
+
     /**
      * Set the size of the box.
      * @param size The size of the box.
@@ -89,6 +110,7 @@ public:
     static QSize calculateMinimumShadowTextureSize(const QSize &boxSize, int radius, const QPoint &offset);
 
 private:
+    Algorithm m_algorithm = Algorithm::BoxBlur;
     QSize m_boxSize;
     qreal m_borderRadius = 0.0;
     qreal m_dpr = 1.0;